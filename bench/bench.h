@@ -0,0 +1,38 @@
+// bench.h - Timing helpers shared by the benchmark drivers.
+#pragma once
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+namespace fms::bench {
+
+	// Best wall clock seconds of f() over r repetitions.
+	template<class F>
+	inline double seconds(F&& f, int r = 5)
+	{
+		double s = 1e300;
+		for (int i = 0; i < r; ++i) {
+			const auto t0 = std::chrono::steady_clock::now();
+			f();
+			const std::chrono::duration<double> dt = std::chrono::steady_clock::now() - t0;
+			if (dt.count() < s) {
+				s = dt.count();
+			}
+		}
+
+		return s;
+	}
+
+	// Keep a result the timed loop would otherwise discard.
+	template<class X>
+	inline void keep(const X& x)
+	{
+		[[maybe_unused]] volatile X sink = x;
+	}
+
+	inline void header(const char* name)
+	{
+		std::printf("%s: %u hardware threads\n", name, std::thread::hardware_concurrency());
+	}
+
+} // namespace fms::bench
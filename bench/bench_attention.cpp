@@ -0,0 +1,50 @@
+// bench_attention.cpp - GFLOP/s of tiled attention for full and causal masks.
+// Usage: bench_attention [d] [heads] [N ...]
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "bench.h"
+#include "fms_nn_attention.h"
+
+using namespace fms;
+
+int main(int argc, char** argv)
+{
+	const std::size_t d = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64;
+	const std::size_t h = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1;
+	std::vector<std::size_t> ns;
+	for (int i = 3; i < argc; ++i) {
+		ns.push_back(std::strtoul(argv[i], nullptr, 10));
+	}
+	if (ns.empty()) {
+		ns = { 512, 1024, 2048, 4096, 8192 };
+	}
+
+	bench::header("attention");
+	std::printf("self attention, head dimension %zu, %zu heads\n", d, h);
+	for (const std::size_t N : ns) {
+		std::vector<double> Q(N * h * d), K(N * h * d), V(N * h * d), O(N * h * d);
+		std::mt19937_64 g(1);
+		std::normal_distribution<double> z;
+		for (std::size_t i = 0; i < Q.size(); ++i) {
+			Q[i] = z(g);
+			K[i] = z(g);
+			V[i] = z(g);
+		}
+		const matrix<const double> Q_(Q.data(), N, h * d), K_(K.data(), N, h * d), V_(V.data(), N, h * d);
+		const matrix<double> O_(O.data(), N, h * d);
+		const int r = N <= 2048 ? 3 : 1;
+
+		for (const bool causal : { false, true }) {
+			// Q K' and P V are 2 N^2 d flops each per head, causal masks about half
+			const double flop = 4. * double(N) * double(N) * double(d) * double(h) * (causal ? 0.5 : 1.);
+			const double s0 = bench::seconds([&]() { nn::attention(std::execution::seq, Q_, K_, V_, O_, h, causal); }, r);
+			const double s1 = bench::seconds([&]() { nn::attention(std::execution::par, Q_, K_, V_, O_, h, causal); }, r);
+			std::printf("N %5zu  %-6s seq %8.3f s %6.2f GFLOP/s  par %8.3f s %6.2f GFLOP/s\n", N, causal ? "causal" : "full",
+				s0, flop / s0 / 1e9, s1, flop / s1 / 1e9);
+		}
+	}
+
+	return 0;
+}
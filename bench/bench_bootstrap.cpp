@@ -0,0 +1,79 @@
+// bench_bootstrap.cpp - Curves per second of bootstrap pricing only tail cash flows against full repricing.
+// Usage: bench_bootstrap [instruments ...]
+#include <cstdio>
+#include <cstdlib>
+#include <tuple>
+#include <vector>
+#include "bench.h"
+#include "fms_bootstrap.h"
+
+using namespace fms;
+
+// bootstrap before split: secant on the full present value through an extrapolated curve
+inline curve::pwflat<> bootstrap_full(std::span<instrument::instrument<>*> is, std::span<double> ps,
+	double _t = 0, double _f = 0.03)
+{
+	curve::pwflat<> f;
+	for (std::size_t i = 0; i < is.size(); ++i) {
+		const auto vp = [&, i](double f_) {
+			return value::present(*is[i], curve::expr::extrapolated(f, _t, f_)) - ps[i];
+		};
+		_f = std::get<0>(root1d::secant(_f, _f + 0.01).solve(vp));
+		_t = is[i]->last().first;
+		f.push_back(_t, _f);
+	}
+
+	return f;
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<std::size_t> ms;
+	for (int i = 1; i < argc; ++i) {
+		ms.push_back(std::strtoul(argv[i], nullptr, 10));
+	}
+	if (ms.empty()) {
+		ms = { 10, 30, 60 };
+	}
+
+	bench::header("bootstrap");
+	std::printf("semiannual par bonds maturing every 6 months\n");
+	for (const std::size_t M : ms) {
+		std::vector<instrument::bond<>> b;
+		std::vector<instrument::instrument<>*> is;
+		std::vector<double> p(M);
+		b.reserve(M);
+		for (std::size_t j = 1; j <= M; ++j) {
+			b.emplace_back(0.5 * double(j), 0.03 + 0.0005 * double(j));
+			p[j - 1] = 1;
+		}
+		for (auto& b_ : b) {
+			is.push_back(&b_);
+		}
+		const std::span<instrument::instrument<>*> is_(is);
+		const std::span<double> p_(p);
+		const int R = int(10'000 / M);
+
+		double s = 0;
+		const double s0 = bench::seconds([&]() {
+			for (int r = 0; r < R; ++r) {
+				s += bootstrap_full(is_, p_).integral(0.5 * double(M));
+			}
+		}, 3);
+		const double s1 = bench::seconds([&]() {
+			for (int r = 0; r < R; ++r) {
+				s += curve::bootstrap(is_, p_, 0., 0.03, curve::method::secant).integral(0.5 * double(M));
+			}
+		}, 3);
+		const double s2 = bench::seconds([&]() {
+			for (int r = 0; r < R; ++r) {
+				s += curve::bootstrap(is_, p_).integral(0.5 * double(M));
+			}
+		}, 3);
+		bench::keep(s);
+		std::printf("instruments %3zu  full %9.0f/s  tail secant %9.0f/s (%.1fx)  tail newton %9.0f/s (%.1fx)\n", M,
+			R / s0, R / s1, s0 / s1, R / s2, s0 / s2);
+	}
+
+	return 0;
+}
@@ -0,0 +1,49 @@
+// bench_bootstrap_scenario.cpp - Scenarios per second of the parallel scenario bootstrap.
+// Usage: bench_bootstrap_scenario [scenarios] [instruments]
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "bench.h"
+#include "fms_bootstrap_scenario.h"
+
+using namespace fms;
+
+int main(int argc, char** argv)
+{
+	const std::size_t N = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10'000;
+	const std::size_t M = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 30;
+
+	std::vector<instrument::bond<>> b;
+	std::vector<instrument::instrument<>*> is;
+	for (std::size_t j = 1; j <= M; ++j) {
+		b.emplace_back(double(j), 0.04);
+	}
+	for (auto& b_ : b) {
+		is.push_back(&b_);
+	}
+	std::vector<double> p(N * M), f(N * M), t(M);
+	for (std::size_t n = 0; n < N; ++n) {
+		for (std::size_t j = 0; j < M; ++j) {
+			p[n * M + j] = 1 + 0.02 * double(n % 100) / 100 - 0.01; // parallel shifts around par
+		}
+	}
+
+	bench::header("bootstrap_scenario");
+	// one curve::bootstrap call per scenario
+	const double s1 = bench::seconds([&]() {
+		for (std::size_t n = 0; n < N; ++n) {
+			auto f_ = curve::bootstrap(std::span(is), std::span(p.data() + n * M, M));
+			f[n * M] = f_.rate()[0];
+		}
+	});
+	std::size_t failed = 0;
+	const double sN = bench::seconds([&]() {
+		failed = curve::bootstrap(std::span(is), matrix<const double>(p.data(), N, M),
+			std::span<double>(t), matrix<double>(f.data(), N, M));
+	});
+	std::printf("%zu scenarios x %zu instruments, %zu failed\n", N, M, failed);
+	std::printf("serial   %10.0f scenarios/s\n", N / s1);
+	std::printf("parallel %10.0f scenarios/s  speedup %.2f\n", N / sN, s1 / sN);
+
+	return failed != 0;
+}
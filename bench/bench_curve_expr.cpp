@@ -0,0 +1,62 @@
+// bench_curve_expr.cpp - Present values and spreads per second through curve expressions against virtual curve wrappers.
+// Usage: bench_curve_expr [instruments]
+#include <cstdio>
+#include <cstdlib>
+#include <tuple>
+#include <vector>
+#include "bench.h"
+#include "fms_curve_pwflat.h"
+#include "fms_valuation.h"
+
+using namespace fms;
+
+int main(int argc, char** argv)
+{
+	const std::size_t K = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10'000;
+
+	std::vector<instrument::bond<>> b;
+	b.reserve(K);
+	for (std::size_t k = 0; k < K; ++k) {
+		b.emplace_back(double(1 + k % 30), 0.01 + 0.0001 * double(k % 50));
+	}
+	double t[10], r[10];
+	for (int i = 0; i < 10; ++i) {
+		t[i] = 3. * (i + 1);
+		r[i] = 0.03 + 0.001 * i;
+	}
+	const curve::pwflat<> f(10, t, r);
+	const curve::base<>& f_ = f;
+	std::vector<double> pv(K), s(K);
+
+	bench::header("curve_expr");
+	std::printf("%zu bonds, 10 knot curve plus a spread\n", K);
+	const double p0 = bench::seconds([&]() {
+		for (std::size_t k = 0; k < K; ++k) {
+			pv[k] = value::present(b[k], static_cast<const curve::base<>&>(f_ + 0.01));
+		}
+	});
+	const double p1 = bench::seconds([&]() {
+		for (std::size_t k = 0; k < K; ++k) {
+			pv[k] = value::present(b[k], curve::expr::make(f) + 0.01);
+		}
+	});
+	std::printf("present virtual %12.0f/s  expression %12.0f/s  speedup %.2f\n", K / p0, K / p1, p0 / p1);
+
+	// value::oas before expressions: secant on the virtual spread curve
+	const double o0 = bench::seconds([&]() {
+		for (std::size_t k = 0; k < K; ++k) {
+			const auto v = [&, k](double s_) {
+				return value::present(b[k], static_cast<const curve::base<>&>(f_ + s_)) - pv[k];
+			};
+			s[k] = std::get<0>(root1d::secant(0., .01).solve(v));
+		}
+	}, 3);
+	const double o1 = bench::seconds([&]() {
+		for (std::size_t k = 0; k < K; ++k) {
+			s[k] = std::get<0>(value::oas(b[k], f, pv[k]));
+		}
+	}, 3);
+	std::printf("oas     virtual %12.0f/s  expression %12.0f/s  speedup %.2f\n", K / o0, K / o1, o0 / o1);
+
+	return 0;
+}
@@ -0,0 +1,69 @@
+// bench_linalg.cpp - GFLOP/s of the blocked gemm and gemv against naive loops.
+// Usage: bench_linalg [n ...]
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "bench.h"
+#include "fms_linalg.h"
+
+using namespace fms;
+
+int main(int argc, char** argv)
+{
+	std::vector<std::size_t> ns;
+	for (int i = 1; i < argc; ++i) {
+		ns.push_back(std::strtoul(argv[i], nullptr, 10));
+	}
+	if (ns.empty()) {
+		ns = { 128, 256, 512, 1024 };
+	}
+
+	bench::header("linalg");
+#ifdef FMS_LINALG_NAMESPACE
+	std::printf("gemm and gemv without a policy dispatch to <linalg>\n");
+#endif
+	for (const std::size_t n : ns) {
+		std::vector<double> A(n * n), B(n * n), C(n * n);
+		for (std::size_t i = 0; i < A.size(); ++i) {
+			A[i] = double(i % 7) - 3;
+			B[i] = double(i % 5) - 2;
+		}
+		const matrix<const double> A_(A.data(), n, n), B_(B.data(), n, n);
+		const matrix<double> C_(C.data(), n, n);
+		const int r = n <= 256 ? 5 : 2;
+		const double flop = 2. * double(n) * double(n) * double(n);
+
+		// C[i, j] = sum_l A[i, l] B[l, j] with stride n access to B
+		const double s0 = bench::seconds([&]() {
+			for (std::size_t i = 0; i < n; ++i) {
+				for (std::size_t j = 0; j < n; ++j) {
+					double s = 0;
+					for (std::size_t l = 0; l < n; ++l) {
+						s += A[i * n + l] * B[l * n + j];
+					}
+					C[i * n + j] = s;
+				}
+			}
+		}, r);
+		const double s1 = bench::seconds([&]() { linalg::gemm(false, false, 1., A_, B_, 0., C_); }, r);
+		const double s2 = bench::seconds([&]() { linalg::gemm(std::execution::par, false, false, 1., A_, B_, 0., C_); }, r);
+		std::printf("gemm n = %4zu  naive %6.2f  seq %6.2f  par %6.2f GFLOP/s\n", n,
+			flop / s0 / 1e9, flop / s1 / 1e9, flop / s2 / 1e9);
+
+		std::vector<double> x(n, 1.), y(n);
+		const double s3 = bench::seconds([&]() {
+			for (int k = 0; k < 10; ++k) {
+				linalg::gemv<double>(false, 1., A_, std::span<const double>(x), 0., std::span<double>(y));
+			}
+		}, r);
+		const double s4 = bench::seconds([&]() {
+			for (int k = 0; k < 10; ++k) {
+				linalg::gemv<double>(true, 1., A_, std::span<const double>(x), 0., std::span<double>(y));
+			}
+		}, r);
+		std::printf("gemv n = %4zu  A x %6.2f  A' x %6.2f GFLOP/s\n", n,
+			20 * double(n) * double(n) / s3 / 1e9, 20 * double(n) * double(n) / s4 / 1e9);
+	}
+
+	return 0;
+}
@@ -0,0 +1,41 @@
+// bench_math.cpp - Values per second of the fms::math span kernels against the standard library.
+// Usage: bench_math [n]
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "bench.h"
+#include "fms_math.h"
+
+using namespace fms;
+
+template<class F, class G>
+inline void compare(const char* name, const std::vector<double>& x, std::vector<double>& y, F&& f, G&& g)
+{
+	const double n = double(x.size());
+	const double s0 = bench::seconds([&]() {
+		for (std::size_t j = 0; j < x.size(); ++j) {
+			y[j] = g(x[j]);
+		}
+	});
+	const double s1 = bench::seconds([&]() { f(std::span<const double>(x), std::span<double>(y)); });
+	std::printf("%-10s std %8.0f M/s  fms %8.0f M/s  speedup %.2f\n", name, n / s0 / 1e6, n / s1 / 1e6, s0 / s1);
+}
+
+int main(int argc, char** argv)
+{
+	const std::size_t N = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1 << 20;
+	std::vector<double> x(N), y(N);
+	for (std::size_t j = 0; j < N; ++j) {
+		x[j] = -8 + 16 * double(j) / double(N);
+	}
+
+	bench::header("math");
+	compare("exp", x, y, [](auto x_, auto y_) { math::exp(x_, y_); }, [](double x_) { return std::exp(x_); });
+	compare("erf", x, y, [](auto x_, auto y_) { math::erf(x_, y_); }, [](double x_) { return std::erf(x_); });
+	compare("erfc", x, y, [](auto x_, auto y_) { math::erfc(x_, y_); }, [](double x_) { return std::erfc(x_); });
+	compare("normal_cdf", x, y, [](auto x_, auto y_) { math::normal_cdf(x_, y_); },
+		[](double x_) { return std::erfc(-x_ / std::sqrt(2.)) / 2; });
+
+	return 0;
+}
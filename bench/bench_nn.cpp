@@ -0,0 +1,44 @@
+// bench_nn.cpp - Samples per second of fms::nn training on an MNIST sized workload.
+// Usage: bench_nn [rows] [epochs] [batch]
+// Inputs are random in [0, 1] with one hot labels, 784-128-10 relu and softmax layers.
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "bench.h"
+#include "fms_nn.h"
+
+using namespace fms;
+
+int main(int argc, char** argv)
+{
+	const std::size_t N = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 60'000;
+	const std::size_t E = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1;
+	const std::size_t B = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 64;
+	const std::size_t w[] = { 784, 128, 10 };
+	const nn::activation a[] = { nn::activation::relu, nn::activation::softmax };
+
+	std::vector<double> X(N * w[0]), Y(N * w[2]);
+	std::mt19937_64 g(1);
+	std::uniform_real_distribution<double> u;
+	for (double& x : X) {
+		x = u(g);
+	}
+	for (std::size_t i = 0; i < N; ++i) {
+		Y[i * w[2] + g() % w[2]] = 1;
+	}
+	const matrix<const double> X_(X.data(), N, w[0]), Y_(Y.data(), N, w[2]);
+
+	bench::header("nn");
+	std::printf("%zu x %zu inputs, %zu-%zu-%zu, batch %zu, %zu epochs\n", N, w[0], w[0], w[1], w[2], B, E);
+	nn::network<> net(std::span<const std::size_t>(w), std::span<const nn::activation>(a), 1);
+	double l = 0;
+	const double s = bench::seconds([&]() {
+		l = net.train(X_, Y_, nn::loss::cross_entropy, 0.01, E, B);
+	}, 1);
+	// forward is 2 m flops per weight, backward twice that
+	const double flop = 6. * double(N) * double(E) * double(w[0] * w[1] + w[1] * w[2]);
+	std::printf("%8.3f s  %10.0f samples/s  %6.2f GFLOP/s  loss %.4f\n", s, double(N) * double(E) / s, flop / s / 1e9, l);
+
+	return 0;
+}
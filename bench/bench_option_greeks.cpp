@@ -0,0 +1,66 @@
+// bench_option_greeks.cpp - Cost of a greeks strip relative to a price strip and to bump and reprice.
+// Usage: bench_option_greeks [strikes]
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "bench.h"
+#include "fms_math.h"
+#include "fms_option_discrete.h"
+#include "fms_option_monte_carlo.h"
+#include "fms_option_normal.h"
+
+using namespace fms;
+using namespace fms::option;
+
+// Time a price strip, a greeks strip, and central difference greeks from nine price strips.
+inline void compare(const char* name, const base<>& m, std::span<const double> k)
+{
+	const double f = 100, s = 0.2, h = 1e-4;
+	std::vector<double> p(k.size());
+	std::vector<black::greeks<>> g(k.size());
+	const auto put = [&](double f_, double s_) { black::put_strip(f_, s_, k, m, std::span<double>(p)); };
+
+	const double s0 = bench::seconds([&]() { put(f, s); });
+	const double s1 = bench::seconds([&]() { black::greeks_strip(f, s, k, m, std::span(g)); });
+	const double s2 = bench::seconds([&]() {
+		put(f, s);
+		for (const double df : { -h, h }) {
+			put(f + df, s); // delta, gamma
+			put(f, s + df); // vega
+			for (const double ds : { -h, h }) {
+				put(f + df, s + ds); // vanna
+			}
+		}
+	});
+	std::printf("%-12s price %10.2f us  greeks %10.2f us (%.2fx)  bump and reprice %10.2f us (%.2fx)\n", name,
+		s0 * 1e6, s1 * 1e6, s1 / s0, s2 * 1e6, s2 / s0);
+}
+
+int main(int argc, char** argv)
+{
+	const std::size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200;
+	std::vector<double> k(n);
+	for (std::size_t j = 0; j < n; ++j) {
+		k[j] = 50 + 100 * double(j) / double(n);
+	}
+
+	bench::header("option_greeks");
+	std::printf("%zu strikes, f = 100, s = 0.2\n", n);
+
+	const normal<> N;
+	compare("normal", N, k);
+
+	// 10000 atoms at normal quantiles
+	constexpr std::size_t M = 10'000;
+	std::vector<double> x(M), p(M, 1.);
+	for (std::size_t i = 0; i < M; ++i) {
+		x[i] = math::normal_quantile((i + 0.5) / M);
+	}
+	const discrete::model<> D(M, x.data(), p.data());
+	compare("discrete", D, k);
+
+	const monte_carlo<> mc(monte_carlo<>::standard_normal, 10'000, 42);
+	compare("monte_carlo", mc, k);
+
+	return 0;
+}
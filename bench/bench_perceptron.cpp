@@ -0,0 +1,65 @@
+// bench_perceptron.cpp - Samples per second of perceptron::fit.
+// Usage: bench_perceptron [rows] [columns] [epochs]
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+#include "bench.h"
+#include "fms_perceptron.h"
+
+using namespace fms;
+
+int main(int argc, char** argv)
+{
+	const std::size_t N = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1'000'000;
+	const std::size_t n = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 100;
+	const std::size_t E = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 5;
+
+	// labels from a random hyperplane with 5% flipped so every epoch runs
+	std::vector<double> X(N * n), h(n);
+	std::unique_ptr<bool[]> y(new bool[N]);
+	std::mt19937_64 g(1);
+	std::normal_distribution<double> z;
+	std::bernoulli_distribution flip(0.05);
+	for (double& h_ : h) {
+		h_ = z(g);
+	}
+	for (std::size_t i = 0; i < N; ++i) {
+		for (std::size_t j = 0; j < n; ++j) {
+			X[i * n + j] = z(g);
+		}
+		y[i] = (linalg::dot(n, h.data(), X.data() + i * n) > 0) != flip(g);
+	}
+	const matrix<const double> X_(X.data(), N, n);
+	const std::span<const bool> y_(y.get(), N);
+
+	bench::header("perceptron");
+	std::printf("%zu rows x %zu columns, %zu epochs\n", N, n, E);
+	const struct {
+		const char* name;
+		perceptron::weights weights;
+	} ws[] = {
+		{ "last", perceptron::weights::last },
+		{ "averaged", perceptron::weights::averaged },
+		{ "pocket", perceptron::weights::pocket },
+	};
+	for (const auto& w : ws) {
+		for (const bool shuffle : { false, true }) {
+			perceptron::options<> o;
+			o.epochs = E;
+			o.shuffle = shuffle;
+			o.weights = w.weights;
+			std::vector<double> w_(n);
+			perceptron::result r{};
+			const double s = bench::seconds([&]() {
+				std::fill(w_.begin(), w_.end(), 0.);
+				r = perceptron::fit(X_, y_, std::span<double>(w_), o);
+			}, 3);
+			std::printf("%-8s shuffle %d  %12.0f samples/s  errors in last epoch %zu\n", w.name, shuffle,
+				double(N) * double(r.epochs) / s, r.errors);
+		}
+	}
+
+	return 0;
+}
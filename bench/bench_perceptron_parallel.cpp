@@ -0,0 +1,85 @@
+// bench_perceptron_parallel.cpp - Samples per second of perceptron::fit_parallel across thread and shard counts.
+// Usage: bench_perceptron_parallel [rows] [columns] [epochs]
+// Thread counts are limited with tbb::global_control when the parallel algorithms run on TBB.
+// Otherwise every row uses all hardware threads and only the shard count varies.
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+#ifdef FMS_BENCH_TBB
+#include <tbb/global_control.h>
+#endif
+#include "bench.h"
+#include "fms_perceptron.h"
+
+using namespace fms;
+
+int main(int argc, char** argv)
+{
+	const std::size_t N = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1'000'000;
+	const std::size_t n = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 100;
+	const std::size_t E = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 5;
+
+	// labels from a random hyperplane with 5% flipped so every epoch runs
+	std::vector<double> X(N * n), h(n);
+	std::unique_ptr<bool[]> y(new bool[N]);
+	std::mt19937_64 g(1);
+	std::normal_distribution<double> z;
+	std::bernoulli_distribution flip(0.05);
+	for (double& h_ : h) {
+		h_ = z(g);
+	}
+	for (std::size_t i = 0; i < N; ++i) {
+		for (std::size_t j = 0; j < n; ++j) {
+			X[i * n + j] = z(g);
+		}
+		y[i] = (linalg::dot(n, h.data(), X.data() + i * n) > 0) != flip(g);
+	}
+	const matrix<const double> X_(X.data(), N, n);
+	const std::span<const bool> y_(y.get(), N);
+
+	bench::header("perceptron_parallel");
+	std::printf("%zu rows x %zu columns, %zu epochs\n", N, n, E);
+
+	std::vector<std::size_t> ts;
+	const std::size_t T = (std::max)(std::thread::hardware_concurrency(), 1u);
+	for (std::size_t t = 1; t < T; t *= 2) {
+		ts.push_back(t);
+	}
+	ts.push_back(T);
+
+	std::vector<double> w(n);
+	for (const std::size_t t : ts) {
+#ifdef FMS_BENCH_TBB
+		const tbb::global_control c(tbb::global_control::max_allowed_parallelism, t);
+#else
+		if (t != T) {
+			continue;
+		}
+#endif
+		// one shard, one per thread, the deterministic default, and oversubscribed
+		std::vector<std::size_t> ss = { 1, t, perceptron::parallel_options<>::deterministic_shards, 4 * T };
+		std::sort(ss.begin(), ss.end());
+		ss.erase(std::unique(ss.begin(), ss.end()), ss.end());
+		for (const bool deterministic : { false, true }) {
+			for (const std::size_t shards : ss) {
+				perceptron::parallel_options<> o;
+				o.epochs = E;
+				o.shards = shards;
+				o.deterministic = deterministic;
+				perceptron::result r{};
+				const double s = bench::seconds([&]() {
+					std::fill(w.begin(), w.end(), 0.);
+					r = perceptron::fit_parallel(X_, y_, std::span<double>(w), o);
+				}, 3);
+				std::printf("threads %3zu  %-13s shards %3zu  %12.0f samples/s\n", t,
+					deterministic ? "deterministic" : "hogwild", shards, double(N) * double(r.epochs) / s);
+			}
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,64 @@
+// bench_pwflat.cpp - Integral lookups per second of the linear knot walk against cached cumulative integrals.
+// Usage: bench_pwflat [lookups] [knots ...]
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "bench.h"
+#include "fms_curve_pwflat.h"
+
+using namespace fms;
+
+int main(int argc, char** argv)
+{
+	const std::size_t M = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100'000;
+	std::vector<std::size_t> ns;
+	for (int i = 2; i < argc; ++i) {
+		ns.push_back(std::strtoul(argv[i], nullptr, 10));
+	}
+	if (ns.empty()) {
+		ns = { 10, 100, 1'000, 10'000 };
+	}
+
+	bench::header("pwflat");
+	std::printf("%zu lookups at uniform times\n", M);
+	for (const std::size_t n : ns) {
+		std::vector<double> t(n), f(n), I(n);
+		for (std::size_t i = 0; i < n; ++i) {
+			t[i] = 30. * double(i + 1) / double(n);
+			f[i] = 0.03 + 0.01 * std::sin(double(i));
+		}
+		pwflat::integrals(n, t.data(), f.data(), I.data());
+		const curve::pwflat<> c(n, t.data(), f.data());
+		std::mt19937_64 r(1);
+		std::uniform_real_distribution<double> u_(0, t.back());
+		std::vector<double> u(M);
+		for (double& u_i : u) {
+			u_i = u_(r);
+		}
+
+		double s = 0;
+		// the walk is O(n) so time fewer lookups for many knots
+		const std::size_t M0 = n <= 1'000 ? M : M / 10;
+		const double s0 = bench::seconds([&]() {
+			for (std::size_t j = 0; j < M0; ++j) {
+				s += pwflat::integral(u[j], n, t.data(), f.data());
+			}
+		}, 3);
+		const double s1 = bench::seconds([&]() {
+			for (std::size_t j = 0; j < M; ++j) {
+				s += pwflat::integral(u[j], n, t.data(), f.data(), I.data());
+			}
+		}, 3);
+		const double s2 = bench::seconds([&]() {
+			for (std::size_t j = 0; j < M; ++j) {
+				s += c.discount(u[j]);
+			}
+		}, 3);
+		bench::keep(s);
+		std::printf("knots %6zu  walk %12.0f/s  cached %12.0f/s  speedup %6.1f  curve discount %12.0f/s\n", n,
+			M0 / s0, M / s1, (M / s1) / (M0 / s0), M / s2);
+	}
+
+	return 0;
+}
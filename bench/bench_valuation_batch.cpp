@@ -0,0 +1,57 @@
+// bench_valuation_batch.cpp - Yields and spreads per second of the lockstep batch solver against scalar solves.
+// Usage: bench_valuation_batch [instruments]
+#include <cstdio>
+#include <cstdlib>
+#include <tuple>
+#include <vector>
+#include "bench.h"
+#include "fms_curve_pwflat.h"
+#include "fms_valuation_batch.h"
+
+using namespace fms;
+
+int main(int argc, char** argv)
+{
+	const std::size_t K = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10'000;
+
+	instrument::portfolio<> p;
+	for (std::size_t k = 0; k < K; ++k) {
+		p.push_back(instrument::bond<>(double(1 + k % 30), 0.01 + 0.0001 * double(k % 50)));
+	}
+	double t[10], r_[10];
+	for (int i = 0; i < 10; ++i) {
+		t[i] = 3. * (i + 1);
+		r_[i] = 0.03 + 0.001 * i;
+	}
+	const curve::pwflat<> f(10, t, r_);
+	std::vector<double> price(K);
+	for (std::size_t k = 0; k < K; ++k) {
+		price[k] = value::price(p[k], 0.02 + 0.0005 * double(k % 40));
+	}
+	std::vector<double> x(K);
+	std::vector<value::root<>> r(K);
+
+	bench::header("valuation_batch");
+	std::printf("%zu instruments\n", K);
+	const double y1 = bench::seconds([&]() {
+		for (std::size_t k = 0; k < K; ++k) {
+			x[k] = std::get<0>(value::yield(p[k], price[k]));
+		}
+	}, 3);
+	const double yN = bench::seconds([&]() {
+		value::yield(p, std::span<const double>(price), std::span(r));
+	}, 3);
+	std::printf("yield scalar %12.0f/s  batch %12.0f/s  speedup %.2f\n", K / y1, K / yN, y1 / yN);
+
+	const double o1 = bench::seconds([&]() {
+		for (std::size_t k = 0; k < K; ++k) {
+			x[k] = std::get<0>(value::oas(p[k], f, price[k]));
+		}
+	}, 3);
+	const double oN = bench::seconds([&]() {
+		value::oas(p, f, std::span<const double>(price), std::span(r));
+	}, 3);
+	std::printf("oas   scalar %12.0f/s  batch %12.0f/s  speedup %.2f\n", K / o1, K / oN, o1 / oN);
+
+	return 0;
+}
@@ -0,0 +1,57 @@
+// bench_valuation_engine.cpp - Instrument x scenario valuations per second of value::engine.
+// Usage: bench_valuation_engine [scenarios] [instruments] [block]
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "bench.h"
+#include "fms_curve_pwflat.h"
+#include "fms_valuation_engine.h"
+
+using namespace fms;
+
+int main(int argc, char** argv)
+{
+	const std::size_t N = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1'000;
+	const std::size_t K = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 10'000;
+	const std::size_t block = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 256;
+
+	instrument::portfolio<> p;
+	for (std::size_t k = 0; k < K; ++k) {
+		p.push_back(instrument::bond<>(double(1 + k % 30), 0.01 + 0.0001 * double(k % 50)));
+	}
+	// scenario curves are parallel shifts of a 10 knot upward sloping curve
+	std::vector<curve::pwflat<>> f;
+	f.reserve(N);
+	for (std::size_t n = 0; n < N; ++n) {
+		double t[10], r[10];
+		for (int i = 0; i < 10; ++i) {
+			t[i] = 3. * (i + 1);
+			r[i] = 0.03 + 0.001 * i + 0.0001 * double(n % 100);
+		}
+		f.emplace_back(10, t, r);
+	}
+	std::vector<const curve::base<>*> fs(N);
+	for (std::size_t n = 0; n < N; ++n) {
+		fs[n] = &f[n];
+	}
+	std::vector<double> pv(N * K);
+
+	bench::header("valuation_engine");
+	const double s1 = bench::seconds([&]() {
+		for (std::size_t n = 0; n < N; ++n) {
+			for (std::size_t k = 0; k < K; ++k) {
+				pv[n * K + k] = value::present(p[k], *fs[n]);
+			}
+		}
+	}, 3);
+	const value::engine e(p, std::span<const curve::base<>* const>(fs), block);
+	const double sN = bench::seconds([&]() {
+		e.present(matrix<double>(pv.data(), N, K));
+	}, 3);
+	const double NK = double(N) * double(K);
+	std::printf("%zu scenarios x %zu instruments, block %zu\n", N, K, block);
+	std::printf("serial %14.0f instrument x scenarios/s\n", NK / s1);
+	std::printf("engine %14.0f instrument x scenarios/s  speedup %.2f\n", NK / sN, s1 / sN);
+
+	return 0;
+}
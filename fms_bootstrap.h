@@ -3,23 +3,85 @@
 #ifdef _DEBUG
 #include <cassert>
 #endif
+#include <algorithm>
+#include <span>
 #include <stdexcept>
+#include <tuple>
 #include <utility>
+#include <vector>
 #include "fms_instrument.h"
 #include "fms_curve_pwflat.h"
 #include "fms_valuation.h"
 #include "fms_math.h"
+#include "fms_mdspan.h"
 
 namespace fms::curve {
 
 	// bootstrap1 - cash deposit
 	// bootstrap2 - forward rate agreement
-	
+
+	// Present value of an instrument as a function of the flat forward f_ after _t.
+	// Cash flows at or before _t do not depend on f_ so they are priced once.
+	// Cash flows after _t are c_j D(_t) exp(-f_ (u_j - _t)) and need no curve evaluation.
+	template<class U, class C, class T = double, class F = double>
+	class split {
+		F pv0; // present value of cash flows at or before _t
+		F D; // discount to _t
+		T _t;
+		std::span<const U> u; // cash flow times after _t
+		std::span<const C> c; // cash flows after _t
+	public:
+		split(const instrument::base<U, C>& i, const curve::base<T, F>& f, T _t)
+			: pv0(0), D(f.discount(_t)), _t(_t)
+		{
+			const auto u_ = i.times();
+			const auto c_ = i.cashes();
+			const std::size_t k = std::upper_bound(u_.begin(), u_.end(), _t) - u_.begin(); // u[k-1] <= _t < u[k]
+
+			for (std::size_t j = 0; j < k; ++j) {
+				pv0 += c_[j] * f.discount(u_[j]);
+			}
+			u = u_.subspan(k);
+			c = c_.subspan(k);
+		}
+
+		// Present value given forward f_ after _t.
+		F operator()(F f_) const
+		{
+			F pv1 = 0;
+
+			for (std::size_t j = 0; j < u.size(); ++j) {
+				pv1 += c[j] * std::exp(-f_ * (u[j] - _t));
+			}
+
+			return pv0 + D * pv1;
+		}
+		// Derivative of present value with respect to f_.
+		// d/df_ c_j D(_t) exp(-f_ (u_j - _t)) = -(u_j - _t) c_j D(_t) exp(-f_ (u_j - _t))
+		F derivative(F f_) const
+		{
+			F dpv1 = 0;
+
+			for (std::size_t j = 0; j < u.size(); ++j) {
+				dpv1 += -(u[j] - _t) * c[j] * std::exp(-f_ * (u[j] - _t));
+			}
+
+			return D * dpv1;
+		}
+	};
+
+	// Root finding method used to bootstrap each instrument.
+	enum class method {
+		secant, // two initial guesses, no derivative
+		newton, // analytic derivative of the tail cash flows
+	};
+
 	// Bootstrap a single instrument given last time on curve and optional initial forward rate guess.
 	// Return point on the curve repricing the instrument.
+	// If n is not null it is set to the number of solver iterations.
 	template<class U, class C, class T = double, class F = double>
 	inline std::pair<T, F> bootstrap0(const instrument::instrument<U, C>& i, const curve::base<T, F>& f,
-		T _t, F _f = math::NaN<F>, F p = 0)
+		T _t, F _f = math::NaN<F>, F p = 0, method m = method::newton, std::size_t* n = nullptr)
 	{
 		const auto uc = i.last(); // last instrument cash flow
 		if (uc.first <= _t) {
@@ -34,25 +96,49 @@ namespace fms::curve {
 			_f = 0.01;
 		}
 
-		const auto vp = [&i, &f, _t, p](F f_) { 
-			return value::present(i, extrapolate(f, _t, f_)) - p; 
+		const split<U, C, T, F> pv(i, f, _t);
+		const auto vp = [&pv, p](F f_) { 
+			return pv(f_) - p; 
 		};
 
-		auto [f_, tol, n] = root1d::secant(_f, _f + 0.01).solve(vp);
+		F f_;
+		std::size_t n_;
+		root1d::stats<F> s;
+		if (m == method::newton) {
+			const auto dvp = [&pv](F f_) {
+				return pv.derivative(f_);
+			};
+			root1d::newton<F, F> r(_f);
+			r.sink = &s;
+			std::tie(f_, std::ignore, n_) = r.solve(vp, dvp);
+		}
+		else {
+			root1d::secant<F, F> r(_f, _f + 0.01);
+			r.sink = &s;
+			std::tie(f_, std::ignore, n_) = r.solve(vp);
+		}
+		root1d::telemetry::record("bootstrap", s);
+		if (n) {
+			*n = n_;
+		}
 
 		return { uc.first, f_ };
 	}
 
 	// Bootstrap a piecewise flat curve from instruments and prices.
+	// If n is not empty it receives the number of solver iterations for each instrument.
 	template<class U = double, class C = double, class P = double>
 	inline curve::pwflat<U, P> bootstrap(std::span<instrument::instrument<U,C>*> is, std::span<P> ps,
-		double _t = 0, double _f = 0.03)
+		double _t = 0, double _f = 0.03, method m = method::newton, std::span<std::size_t> n = {})
 		//requires std::convertible_to<I,const instrument::base<U,C>&>
 	{
 		// Validate inputs
 		if (is.size() != ps.size()) {
 			throw std::invalid_argument("bootstrap: instruments and prices must have the same size");
 		}
+		if (!n.empty() && n.size() != is.size()) {
+			throw std::invalid_argument("bootstrap: iteration counts must have the same size as instruments");
+		}
 
 		curve::pwflat<U, P> f;
 		for (std::size_t i = 0; i < is.size(); ++i) {
@@ -62,7 +148,7 @@ namespace fms::curve {
 			}
 
 			// FIX: Use different variable name to avoid shadowing parameter _f
-			const auto [t_next, f_next] = bootstrap0(*(is[i]), f, _t, _f, ps[i]);
+			const auto [t_next, f_next] = bootstrap0(*(is[i]), f, _t, _f, ps[i], m, n.empty() ? nullptr : &n[i]);
 
 			// Check for failed bootstrap
 			if (std::isnan(t_next) || std::isnan(f_next)) {
@@ -76,6 +162,135 @@ namespace fms::curve {
 
 		return f;
 	}
+
+	// Curve that remembers its instruments, prices, and solutions so that
+	// only knots at or after the first changed price are bootstrapped again.
+	template<class U = double, class C = double, class P = double>
+	class bootstrapper : public curve::pwflat<U, P> {
+		std::vector<instrument::instrument<U, C>> is; // copy of instruments
+		std::vector<P> p; // last prices
+		std::vector<std::size_t> n; // solver iterations per knot
+		U _t;
+		P _f;
+		method m;
+	public:
+		bootstrapper(std::span<instrument::instrument<U, C>*> is_, std::span<const P> p_,
+			U _t = 0, P _f = 0.03, method m = method::newton)
+			: p(p_.size(), math::NaN<P>), n(p_.size()), _t(_t), _f(_f), m(m)
+		{
+			if (is_.size() != p_.size()) {
+				throw std::invalid_argument("bootstrapper: instruments and prices must have the same size");
+			}
+			is.reserve(is_.size());
+			for (const auto i : is_) {
+				if (i == nullptr) {
+					throw std::invalid_argument("bootstrapper: instrument pointer is null");
+				}
+				is.push_back(*i);
+			}
+			update(p_);
+		}
+		bootstrapper(const bootstrapper&) = default;
+		bootstrapper& operator=(const bootstrapper&) = default;
+		~bootstrapper() = default;
+
+		// Solver iterations used for each knot by the last solve.
+		std::span<const std::size_t> iterations() const
+		{
+			return n;
+		}
+
+		// Bootstrap again from the first changed price using the previous forwards as initial guesses.
+		// Return indices of knots whose forward changed.
+		// Knots are solved into a copy so a failed solve leaves the curve, prices, and iterations unchanged.
+		std::vector<std::size_t> update(std::span<const P> p_)
+		{
+			if (p_.size() != p.size()) {
+				throw std::invalid_argument("bootstrapper: prices must have one value per instrument");
+			}
+
+			std::vector<std::size_t> moved;
+			const std::size_t k = (std::min)(static_cast<std::size_t>(std::mismatch(p.begin(), p.end(), p_.begin()).first - p.begin()),
+				this->size());
+			if (k == p.size() && this->size() == p.size()) {
+				return moved;
+			}
+
+			const std::span<const P> f0(this->rate() + k, this->size() - k); // previous solutions
+			curve::pwflat<U, P> f(k, this->time(), this->rate());
+			std::vector<std::size_t> n_(n);
+			for (std::size_t j = k; j < is.size(); ++j) {
+				const U t_ = j == 0 ? _t : f.back().first;
+				const P g_ = j - k < f0.size() ? f0[j - k] : j == 0 ? _f : f.back().second;
+				const auto [tj, fj] = bootstrap0(is[j], f, t_, g_, p_[j], m, &n_[j]);
+				if (std::isnan(tj) || std::isnan(fj)) {
+					throw std::runtime_error("bootstrapper: failed to bootstrap instrument");
+				}
+				f.push_back(tj, fj);
+				if (j - k >= f0.size() || fj != f0[j - k]) {
+					moved.push_back(j);
+				}
+			}
+
+			// commit
+			std::vector<P> p__(p_.begin(), p_.end());
+			static_cast<curve::pwflat<U, P>&>(*this) = std::move(f);
+			p.swap(p__);
+			n.swap(n_);
+
+			return moved;
+		}
+	};
+
+	// Jacobian J[k, j] = df_k/dp_j of a curve f bootstrapped from instruments is and prices p.
+	// Instrument k satisfies V_k(f_0, ..., f_k) = p_k so by the implicit function theorem
+	// sum_{i <= k} dV_k/df_i df_i/dp_j = delta_kj. The Jacobian is lower triangular and
+	// dV_k/df_i = -sum_j c_j D(u_j) |[t_{i-1}, t_i] cap [0, u_j]|.
+	// Costs about the same as one bootstrap instead of one bootstrap per bumped quote.
+	template<class U = double, class C = double, class P = double>
+	inline void jacobian(std::span<instrument::instrument<U, C>*> is, const curve::pwflat<U, P>& f, matrix<P> J)
+	{
+		const std::size_t M = is.size();
+		if (f.size() != M) {
+			throw std::invalid_argument("jacobian: curve must have one knot per instrument");
+		}
+		if (J.extent(0) != M || J.extent(1) != M) {
+			throw std::invalid_argument("jacobian: J must be square with one row per instrument");
+		}
+
+		const U* t = f.time();
+		std::vector<P> dV(M); // dV_k/df_i
+		for (std::size_t k = 0; k < M; ++k) {
+			std::fill_n(dV.begin(), k + 1, P(0));
+			const auto u = is[k]->times();
+			const auto c = is[k]->cashes();
+			for (std::size_t j = 0; j < u.size(); ++j) {
+				const P cD = c[j] * f.discount(u[j]);
+				U t_ = 0;
+				for (std::size_t i = 0; i <= k && t_ < u[j]; ++i) {
+					dV[i] -= cD * ((std::min)(u[j], t[i]) - t_);
+					t_ = t[i];
+				}
+			}
+			if (dV[k] == 0) {
+				throw std::runtime_error("jacobian: instrument does not depend on its forward");
+			}
+
+			P* Jk = row(J, k);
+			for (std::size_t j = 0; j < M; ++j) {
+				if (j > k) {
+					Jk[j] = 0;
+					continue;
+				}
+				P s = j == k ? P(1) : P(0);
+				for (std::size_t i = j; i < k; ++i) {
+					s -= dV[i] * row(J, i)[j];
+				}
+				Jk[j] = s / dV[k];
+			}
+		}
+	}
+
 #ifdef _DEBUG
 	inline int bootstrap_test()
 	{
@@ -92,6 +307,101 @@ namespace fms::curve {
 			auto [_t, _f] = curve::bootstrap0(zcb, f, 0., 0.2, 1.);
 			assert(_t == 1);
 			assert(math::abs(_f - r) <= math::sqrt_epsilon<double>);
+			std::size_t n;
+			auto [_t2, _f2] = curve::bootstrap0(zcb, f, 0., 0.2, 1., method::secant, &n);
+			assert(_t2 == 1);
+			assert(math::abs(_f2 - r) <= math::sqrt_epsilon<double>);
+			assert(n > 0);
+		}
+		{
+			curve::pwflat<> f;
+			f.push_back(1., 0.02);
+			const auto b = instrument::bond<>(3, 0.04);
+			const split s(b, f, 1.);
+			const double h = 1e-6;
+			for (double f_ : { 0., 0.03, 0.05 }) {
+				auto df = (s(f_ + h) - s(f_ - h)) / (2 * h);
+				assert(math::abs(s.derivative(f_) - df) <= 1e-8);
+			}
+		}
+		{
+			// split value agrees with full repricing
+			curve::pwflat<> f;
+			f.push_back(1., 0.02).push_back(2., 0.03);
+			const auto b = instrument::bond<>(5, 0.04);
+			const split s(b, f, 2.);
+			for (double f_ : { 0., 0.03, 0.05 }) {
+				auto pv = value::present(b, extrapolate(f, 2., f_));
+				assert(math::abs(s(f_) - pv) <= math::epsilon<> * 10);
+			}
+		}
+		{
+			std::vector<instrument::bond<>> b;
+			std::vector<instrument::instrument<>*> is;
+			std::vector<double> p;
+			for (int u = 1; u <= 10; ++u) {
+				b.emplace_back(u, 0.03 + 0.002 * u);
+				p.push_back(1.);
+			}
+			for (auto& b_ : b) {
+				is.push_back(&b_);
+			}
+			std::vector<std::size_t> n(is.size());
+			auto f = curve::bootstrap(std::span(is), std::span(p), 0., 0.03, method::newton, std::span(n));
+			assert(f.size() == b.size());
+			for (std::size_t i = 0; i < b.size(); ++i) {
+				assert(math::abs(value::present(b[i], f) - 1) <= math::sqrt_epsilon<>);
+				assert(0 < n[i] && n[i] < 10);
+			}
+
+			// incremental update matches full bootstrap
+			bootstrapper<> bs{ std::span(is), std::span<const double>(p) };
+			assert(bs == f);
+			assert(bs.update(std::span<const double>(p)).empty());
+			p[5] += 0.001;
+			auto moved = bs.update(std::span<const double>(p));
+			assert(!moved.empty() && moved.front() == 5);
+			for (std::size_t i = 0; i < b.size(); ++i) {
+				assert(math::abs(value::present(b[i], bs) - p[i]) <= math::sqrt_epsilon<>);
+				assert(i >= 5 || bs.rate()[i] == f.rate()[i]);
+			}
+			p[5] -= 0.001;
+
+			// failed update leaves the curve unchanged
+			const auto bs0 = bs;
+			const double p5 = p[5];
+			p[5] = -1; // no forward gives a negative price
+			bool thrown = false;
+			try {
+				bs.update(std::span<const double>(p));
+			}
+			catch (const std::exception&) {
+				thrown = true;
+			}
+			assert(thrown);
+			assert(bs == bs0 && bs.size() == b.size());
+			p[5] = p5;
+			assert(bs.update(std::span<const double>(p)).front() == 5);
+			for (std::size_t i = 0; i < b.size(); ++i) {
+				assert(math::abs(value::present(b[i], bs) - p[i]) <= math::sqrt_epsilon<>);
+			}
+
+			// compare with bump and rebootstrap
+			const std::size_t M = is.size();
+			std::vector<double> J(M * M);
+			jacobian(std::span(is), f, matrix<double>(J.data(), M, M));
+			const double h = 1e-6;
+			for (std::size_t j = 0; j < M; ++j) {
+				p[j] += h;
+				auto fu = curve::bootstrap(std::span(is), std::span(p));
+				p[j] -= 2 * h;
+				auto fd = curve::bootstrap(std::span(is), std::span(p));
+				p[j] += h;
+				for (std::size_t k = 0; k < M; ++k) {
+					double df = (fu.rate()[k] - fd.rate()[k]) / (2 * h);
+					assert(math::abs(J[k * M + j] - df) <= 1e-5);
+				}
+			}
 		}
 
 		return 0;
@@ -0,0 +1,112 @@
+// fms_bootstrap_scenario.h - Bootstrap one set of instruments against many price scenarios in parallel.
+#pragma once
+#ifdef _DEBUG
+#include <cassert>
+#endif
+#include <algorithm>
+#include <atomic>
+#include <execution>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <vector>
+#include "fms_bootstrap.h"
+#include "fms_mdspan.h"
+
+namespace fms::curve {
+
+	// Bootstrap instruments is against each row of the N x M price matrix p.
+	// Every curve has knots at the instrument maturities t[j], j < M, and
+	// the forwards of scenario n are written to row n of the N x M matrix f.
+	// Scenarios are independent and run in parallel.
+	// Return the number of scenarios that failed. Their row of f is set to NaN.
+	template<class U = double, class C = double, class P = double>
+	inline std::size_t bootstrap(std::span<instrument::instrument<U, C>*> is, matrix<const P> p,
+		std::span<U> t, matrix<P> f, U _t = 0, P _f = 0.03, method m = method::newton)
+	{
+		const std::size_t N = p.extent(0);
+		const std::size_t M = p.extent(1);
+
+		if (is.size() != M || t.size() != M) {
+			throw std::invalid_argument("bootstrap: instruments, times, and price columns must have the same size");
+		}
+		if (f.extent(0) != N || f.extent(1) != M) {
+			throw std::invalid_argument("bootstrap: forwards must have the same shape as prices");
+		}
+		for (std::size_t j = 0; j < M; ++j) {
+			if (is[j] == nullptr) {
+				throw std::invalid_argument("bootstrap: instrument pointer is null");
+			}
+			t[j] = is[j]->last().first;
+		}
+
+		std::vector<std::size_t> n(N);
+		std::iota(n.begin(), n.end(), std::size_t(0));
+		std::atomic<std::size_t> failed = 0;
+
+		// Exceptions must not escape a parallel algorithm.
+		std::for_each(std::execution::par, n.begin(), n.end(), [&](std::size_t n_) {
+			// Reuse the curve storage of each worker thread across scenarios.
+			thread_local curve::pwflat<U, P> f_;
+			const P* p_ = row(p, n_);
+			P* fn = row(f, n_);
+
+			f_.clear();
+			try {
+				U t_ = _t;
+				P r_ = _f;
+				for (std::size_t j = 0; j < M; ++j) {
+					const auto [tj, fj] = bootstrap0(*is[j], f_, t_, r_, p_[j], m);
+					if (std::isnan(tj) || std::isnan(fj)) {
+						throw std::runtime_error("bootstrap: failed to bootstrap instrument");
+					}
+					f_.push_back(tj, fj);
+					fn[j] = fj;
+					t_ = tj;
+					r_ = fj;
+				}
+			}
+			catch (...) {
+				std::fill_n(fn, M, math::NaN<P>);
+				++failed;
+			}
+		});
+
+		return failed;
+	}
+#ifdef _DEBUG
+	inline int bootstrap_scenario_test()
+	{
+		{
+			std::vector<instrument::bond<>> b;
+			std::vector<instrument::instrument<>*> is;
+			for (int u = 1; u <= 5; ++u) {
+				b.emplace_back(u, 0.04);
+			}
+			for (auto& b_ : b) {
+				is.push_back(&b_);
+			}
+			constexpr std::size_t N = 3, M = 5;
+			double p[N * M], f[N * M], t[M];
+			for (std::size_t n = 0; n < N; ++n) {
+				for (std::size_t j = 0; j < M; ++j) {
+					p[n * M + j] = 1 + 0.01 * n; // parallel shift of prices
+				}
+			}
+			auto k = bootstrap(std::span(is), matrix<const double>(p, N, M), std::span<double>(t), matrix<double>(f, N, M));
+			assert(k == 0);
+			for (std::size_t n = 0; n < N; ++n) {
+				auto f_ = bootstrap(std::span(is), std::span(p + n * M, M));
+				assert(f_.size() == M);
+				for (std::size_t j = 0; j < M; ++j) {
+					assert(t[j] == f_.time()[j]);
+					assert(f[n * M + j] == f_.rate()[j]);
+				}
+			}
+		}
+
+		return 0;
+	}
+#endif // _DEBUG
+
+} // namespace fms::curve
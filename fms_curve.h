@@ -4,6 +4,8 @@
 #include<cassert>
 #endif // _DEBUG
 #include <cmath>
+#include <algorithm>
+#include <span>
 #include "fms_error.h"
 #include "fms_math.h"
 
@@ -48,9 +50,50 @@ namespace fms::curve {
 			return u < 0 ? math::NaN<F> : u < math::sqrt_epsilon<T> ? forward(u, t, f) : integral(u, t, f) / u;
 		}
 
+		// Batch versions evaluate the curve at all times u in one call.
+		// Subclasses can override _forwards and _integrals to share work across times,
+		// e.g. a single sweep over knots when u is increasing.
+
+		// Forward at each u[j].
+		void forward(std::span<const T> u, std::span<F> f) const
+		{
+			ensure(u.size() == f.size() || !"curve::forward: u and f must have the same size");
+			_forwards(u, f);
+		}
+
+		// Integral from 0 to each u[j].
+		void integral(std::span<const T> u, std::span<F> I) const
+		{
+			ensure(u.size() == I.size() || !"curve::integral: u and I must have the same size");
+			_integrals(u, I);
+		}
+
+		// Discount at each u[j].
+		void discount(std::span<const T> u, std::span<F> D) const
+		{
+			integral(u, D);
+			for (auto& D_ : D) {
+				D_ = std::exp(-D_);
+			}
+		}
+
 	private:
 		constexpr virtual F _forward(T u) const = 0;
 		constexpr virtual F _integral(T u) const = 0;
+	protected:
+		// Default to scalar evaluation.
+		virtual void _forwards(std::span<const T> u, std::span<F> f) const
+		{
+			for (std::size_t j = 0; j < u.size(); ++j) {
+				f[j] = forward(u[j]);
+			}
+		}
+		virtual void _integrals(std::span<const T> u, std::span<F> I) const
+		{
+			for (std::size_t j = 0; j < u.size(); ++j) {
+				I[j] = integral(u[j]);
+			}
+		}
 	};
 
 	// Provide t and f where forward(u) = f for u > t.
@@ -73,6 +116,26 @@ namespace fms::curve {
 		{
 			return f.integral(u, _t, _f);
 		}
+		// Batch evaluate f up to _t and extrapolate the rest.
+		void _integrals(std::span<const T> u, std::span<F> I) const override
+		{
+			if (!std::is_sorted(u.begin(), u.end())) {
+				for (std::size_t j = 0; j < u.size(); ++j) {
+					I[j] = f.integral(u[j], _t, _f);
+				}
+
+				return;
+			}
+
+			std::size_t k = std::upper_bound(u.begin(), u.end(), _t) - u.begin(); // u[k-1] <= _t < u[k]
+			f.integral(u.first(k), I.first(k));
+			if (k < u.size()) {
+				const F I_ = f.integral(_t);
+				for (std::size_t j = k; j < u.size(); ++j) {
+					I[j] = I_ + _f * (u[j] - _t);
+				}
+			}
+		}
 	};
 
 	// Constant curve.
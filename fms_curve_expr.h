@@ -0,0 +1,340 @@
+// fms_curve_expr.h - Compile time curve composition without virtual dispatch.
+/*
+	auto g = expr::make(f) + curve::constant(s) + curve::bump(b, t0, t1);
+
+	The type of g is a single concrete curve. Leaves call the concrete
+	_forward/_integral of each curve with a qualified, non-virtual call
+	so the compiler can inline the whole expression.
+	Leaves hold lvalue curves by reference and rvalue curves by value.
+	Use expr::erased(g) to get a curve::base when a type-erased curve is needed.
+*/
+#pragma once
+#include <cmath>
+#include <algorithm>
+#include <concepts>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include "fms_error.h"
+#include "fms_math.h"
+#include "fms_curve.h"
+
+namespace fms::curve::expr {
+
+	// Interface for expression nodes. Subclasses implement _forward and _integral
+	// and can shadow _integrals to evaluate many times at once.
+	template<class D, class T = double, class F = double>
+	struct expression {
+		using time_type = T;
+		using rate_type = F;
+
+		constexpr const D& self() const
+		{
+			return static_cast<const D&>(*this);
+		}
+
+		constexpr F forward(T u) const
+		{
+			return u < 0 ? math::NaN<F> : self()._forward(u);
+		}
+		constexpr F operator()(T u) const
+		{
+			return forward(u);
+		}
+		constexpr F integral(T u) const
+		{
+			return u < 0 ? math::NaN<F> : u == 0 ? 0 : self()._integral(u);
+		}
+		constexpr F discount(T u) const
+		{
+			return u < 0 ? math::NaN<F> : std::exp(-integral(u));
+		}
+		constexpr F spot(T u) const
+		{
+			return u < 0 ? math::NaN<F> : u < math::sqrt_epsilon<T> ? forward(u) : integral(u) / u;
+		}
+
+		// Integral from 0 to each u[j].
+		constexpr void integral(std::span<const T> u, std::span<F> I) const
+		{
+			ensure(u.size() == I.size() || !"curve::expr::integral: u and I must have the same size");
+			self()._integrals(u, I);
+			for (std::size_t j = 0; j < u.size(); ++j) {
+				if (u[j] <= 0) {
+					I[j] = u[j] < 0 ? math::NaN<F> : 0;
+				}
+			}
+		}
+		// Discount at each u[j].
+		constexpr void discount(std::span<const T> u, std::span<F> D_) const
+		{
+			integral(u, D_);
+			for (auto& d : D_) {
+				d = std::exp(-d);
+			}
+		}
+
+		// Default to scalar evaluation.
+		constexpr void _integrals(std::span<const T> u, std::span<F> I) const
+		{
+			for (std::size_t j = 0; j < u.size(); ++j) {
+				I[j] = self()._integral(u[j]);
+			}
+		}
+	};
+
+	template<class E>
+	concept node = std::derived_from<std::remove_cvref_t<E>,
+		expression<std::remove_cvref_t<E>, typename std::remove_cvref_t<E>::time_type, typename std::remove_cvref_t<E>::rate_type>>;
+
+	template<class C>
+	concept base_curve = std::derived_from<std::remove_cvref_t<C>,
+		curve::base<typename std::remove_cvref_t<C>::time_type, typename std::remove_cvref_t<C>::rate_type>>;
+
+	// Curve derived from curve::base. C is either a value type or a const reference.
+	template<class C>
+	class leaf : public expression<leaf<C>, typename std::remove_cvref_t<C>::time_type, typename std::remove_cvref_t<C>::rate_type> {
+		using X = std::remove_cvref_t<C>;
+		using T = typename X::time_type;
+		using F = typename X::rate_type;
+		C c;
+	public:
+		constexpr leaf(C c)
+			: c(static_cast<C>(c))
+		{ }
+
+		// Qualified calls bypass the vtable unless X is only known through its interface.
+		constexpr F _forward(T u) const
+		{
+			if constexpr (std::is_abstract_v<X>) {
+				return c.forward(u);
+			}
+			else {
+				return c.X::_forward(u);
+			}
+		}
+		constexpr F _integral(T u) const
+		{
+			if constexpr (std::is_abstract_v<X>) {
+				return c.integral(u);
+			}
+			else {
+				return c.X::_integral(u);
+			}
+		}
+		// Use the batch curve API, e.g. a single sweep over pwflat knots.
+		void _integrals(std::span<const T> u, std::span<F> I) const
+		{
+			c.integral(u, I);
+		}
+	};
+
+	// Expressions are used as is and curves become leaves.
+	template<class E>
+		requires node<E>
+	constexpr decltype(auto) make(E&& e)
+	{
+		return std::forward<E>(e);
+	}
+	template<class C>
+		requires base_curve<C>
+	constexpr auto make(C&& c)
+	{
+		if constexpr (std::is_lvalue_reference_v<C>) {
+			return leaf<const std::remove_reference_t<C>&>(c);
+		}
+		else {
+			return leaf<C>(std::move(c));
+		}
+	}
+
+	template<class E>
+	using make_t = std::remove_cvref_t<decltype(make(std::declval<E>()))>;
+
+	// Sum of two expressions.
+	template<class L, class R>
+	class sum : public expression<sum<L, R>, typename L::time_type, typename L::rate_type> {
+		using T = typename L::time_type;
+		using F = typename L::rate_type;
+		L l;
+		R r;
+	public:
+		constexpr sum(L l, R r)
+			: l(std::move(l)), r(std::move(r))
+		{ }
+
+		constexpr F _forward(T u) const
+		{
+			return l._forward(u) + r._forward(u);
+		}
+		constexpr F _integral(T u) const
+		{
+			return l._integral(u) + r._integral(u);
+		}
+		// Batch the left side. The right side is usually a cheap spread or bump.
+		void _integrals(std::span<const T> u, std::span<F> I) const
+		{
+			l._integrals(u, I);
+			for (std::size_t j = 0; j < u.size(); ++j) {
+				I[j] += r._integral(u[j]);
+			}
+		}
+	};
+
+	// Add two expressions or an expression and a curve.
+	template<class L, class R>
+		requires node<L> && (node<R> || base_curve<R>)
+	constexpr auto operator+(L&& l, R&& r)
+	{
+		return sum<make_t<L>, make_t<R>>(make(std::forward<L>(l)), make(std::forward<R>(r)));
+	}
+	// Shift expression rates by spread s.
+	template<class L>
+		requires node<L>
+	constexpr auto operator+(L&& l, typename std::remove_cvref_t<L>::rate_type s)
+	{
+		using T = typename std::remove_cvref_t<L>::time_type;
+		using F = typename std::remove_cvref_t<L>::rate_type;
+
+		return std::forward<L>(l) + curve::constant<T, F>(s);
+	}
+
+	// Forward f after t.
+	template<class E>
+	class extrapolate : public expression<extrapolate<E>, typename E::time_type, typename E::rate_type> {
+		using T = typename E::time_type;
+		using F = typename E::rate_type;
+		E e;
+		T t;
+		F f;
+	public:
+		constexpr extrapolate(E e, T t = math::infinity<T>, F f = math::NaN<F>)
+			: e(std::move(e)), t(t), f(f)
+		{ }
+
+		constexpr F _forward(T u) const
+		{
+			return u <= t ? e._forward(u) : f;
+		}
+		constexpr F _integral(T u) const
+		{
+			return u <= t ? e._integral(u) : (t > 0 ? e._integral(t) : 0) + f * (u - t);
+		}
+		void _integrals(std::span<const T> u, std::span<F> I) const
+		{
+			if (!std::is_sorted(u.begin(), u.end())) {
+				return expression<extrapolate<E>, T, F>::_integrals(u, I);
+			}
+
+			std::size_t k = std::upper_bound(u.begin(), u.end(), t) - u.begin(); // u[k-1] <= t < u[k]
+			e._integrals(u.first(k), I.first(k));
+			if (k < u.size()) {
+				const F I_ = t > 0 ? e._integral(t) : 0;
+				for (std::size_t j = k; j < u.size(); ++j) {
+					I[j] = I_ + f * (u[j] - t);
+				}
+			}
+		}
+	};
+	template<class E, class T, class F>
+	constexpr auto extrapolated(E&& e, T t, F f)
+	{
+		return extrapolate<make_t<E>>(make(std::forward<E>(e)), t, f);
+	}
+
+	// Shift curve forward by t.
+	template<class E>
+	class translate : public expression<translate<E>, typename E::time_type, typename E::rate_type> {
+		using T = typename E::time_type;
+		using F = typename E::rate_type;
+		E e;
+		T t;
+	public:
+		constexpr translate(E e, T t)
+			: e(std::move(e)), t(t)
+		{ }
+
+		constexpr F _forward(T u) const
+		{
+			return e.forward(u + t);
+		}
+		constexpr F _integral(T u) const
+		{
+			return e.integral(u + t) - e.integral(t);
+		}
+	};
+	template<class E, class T>
+	constexpr auto translated(E&& e, T t)
+	{
+		return translate<make_t<E>>(make(std::forward<E>(e)), t);
+	}
+
+	// Type-erased curve::base holding an expression.
+	template<class E>
+	class erased : public curve::base<typename E::time_type, typename E::rate_type> {
+		using T = typename E::time_type;
+		using F = typename E::rate_type;
+		E e;
+	public:
+		constexpr erased(E e)
+			: e(std::move(e))
+		{ }
+
+		constexpr F _forward(T u) const override
+		{
+			return e._forward(u);
+		}
+		constexpr F _integral(T u) const override
+		{
+			return e._integral(u);
+		}
+		void _integrals(std::span<const T> u, std::span<F> I) const override
+		{
+			e._integrals(u, I);
+		}
+	};
+
+#ifdef _DEBUG
+	inline int expression_test()
+	{
+		{
+			constexpr auto c = make(curve::constant(0.01)) + curve::constant(0.02);
+			static_assert(c.forward(1.) == 0.01 + 0.02);
+			static_assert(c.integral(0.) == 0);
+			static_assert(c.integral(2.) == 0.01 * 2 + 0.02 * 2);
+			static_assert(math::isnan(c.forward(-1.)));
+		}
+		{
+			curve::constant f(0.03);
+			curve::bump b(0.01, 1., 2.);
+			auto g = make(f) + 0.01 + b; // reference to f and b
+			curve::constant s(0.01);
+			curve::plus fs(f, s);
+			curve::plus h(fs, b);
+			for (double u : { 0., 0.5, 1., 1.5, 2., 3. }) {
+				ensure(g.forward(u) == h.forward(u));
+				ensure(g.integral(u) == h.integral(u));
+				ensure(g.discount(u) == h.discount(u));
+			}
+			erased e(g);
+			ensure(e.integral(1.5) == g.integral(1.5));
+		}
+		{
+			curve::constant f(0.03);
+			auto g = extrapolated(f, 1., 0.05);
+			curve::extrapolate h(f, 1., 0.05);
+			double u[] = { 0, 0.5, 1, 2, 3 };
+			double Ig[5], Ih[5];
+			g.integral(u, Ig);
+			h.integral(u, Ih);
+			for (std::size_t j = 0; j < 5; ++j) {
+				ensure(g.integral(u[j]) == h.integral(u[j]));
+				ensure(Ig[j] == Ih[j]);
+			}
+		}
+
+		return 0;
+	}
+#endif // _DEBUG
+
+} // namespace fms::curve::expr
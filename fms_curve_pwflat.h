@@ -14,19 +14,22 @@ namespace fms::curve {
 	class pwflat : public base<T, F> {
 		std::vector<T> t_;
 		std::vector<F> f_;
+		std::vector<F> I_; // I_[i] = int_0^t_[i] f(s) ds
 	public:
 		// constant curve
 		constexpr pwflat()
 		{ }
 		pwflat(size_t n, const T* t, const F* f)
-			: t_(t, t + n), f_(f, f + n)
+			: t_(t, t + n), f_(f, f + n), I_(n)
 		{
 			ensure(fms::pwflat::monotonic(n, t));
+			fms::pwflat::integrals(n, t_.data(), f_.data(), I_.data());
 		}
 		pwflat(std::span<T> t, std::span<F> f)
-			: t_(t.begin(), t.end()), f_(f.begin(), f.end())
+			: t_(t.begin(), t.end()), f_(f.begin(), f.end()), I_(t.size())
 		{
 			ensure(t_.size() == f_.size() || !"pwflat: t and f must have the same size");
+			fms::pwflat::integrals(t_.size(), t_.data(), f_.data(), I_.data());
 		}
 		pwflat(const pwflat&) = default;
 		pwflat& operator=(const pwflat&) = default;
@@ -46,7 +49,22 @@ namespace fms::curve {
 		}
 		F _integral(T u) const noexcept override
 		{
-			return fms::pwflat::integral(u, t_.size(), t_.data(), f_.data());
+			return fms::pwflat::integral(u, t_.size(), t_.data(), f_.data(), I_.data());
+		}
+		// Sweep knots once if u is increasing.
+		void _forwards(std::span<const T> u, std::span<F> f) const override
+		{
+			if (!std::is_sorted(u.begin(), u.end())) {
+				return base<T, F>::_forwards(u, f);
+			}
+			fms::pwflat::forward(u.size(), u.data(), f.data(), t_.size(), t_.data(), f_.data());
+		}
+		void _integrals(std::span<const T> u, std::span<F> I) const override
+		{
+			if (!std::is_sorted(u.begin(), u.end())) {
+				return base<T, F>::_integrals(u, I);
+			}
+			fms::pwflat::integral(u.size(), u.data(), I.data(), t_.size(), t_.data(), f_.data(), I_.data());
 		}
 
 		bool clear() noexcept
@@ -55,6 +73,7 @@ namespace fms::curve {
 
 			t_.clear();
 			f_.clear();
+			I_.clear();
 
 			return empty;
 		}
@@ -75,11 +94,23 @@ namespace fms::curve {
 		{
 			ensure(size() == 0 || t >= t_.back());
 
+			I_.push_back(size() == 0 ? f * t : I_.back() + f * (t - t_.back()));
 			t_.push_back(t);
 			f_.push_back(f);
 
 			return *this;
 		}
+		// Keep the first n points.
+		pwflat& resize(std::size_t n)
+		{
+			ensure(n <= size() || !"pwflat: resize can only remove points");
+
+			t_.resize(n);
+			f_.resize(n);
+			I_.resize(n);
+
+			return *this;
+		}
 		pwflat& push_back(std::pair<T, F> p)
 		{
 			return push_back(p.first, p.second);
@@ -101,6 +132,17 @@ namespace fms::curve {
 			c2 = c;
 			assert(!(c2 != c));
 		}
+		{
+			pwflat<> c;
+			c.push_back(1, 0.01).push_back(2, 0.02).push_back(5, 0.03);
+			for (double u : { 0.5, 1., 3., 5. }) {
+				assert(c.integral(u) == fms::pwflat::integral(u, c.size(), c.time(), c.rate()));
+			}
+			assert(math::isnan(c.integral(6)));
+			pwflat<> c2(c.size(), c.time(), c.rate());
+			assert(c2 == c);
+			assert(c2.integral(3) == c.integral(3));
+		}
 
 		return 0;
 	}
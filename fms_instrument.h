@@ -2,6 +2,7 @@
 #pragma once
 #include <algorithm>
 #include <span>
+#include <utility>
 #include <vector>
 #include "fms_error.h"
 
@@ -23,7 +24,7 @@ namespace fms::instrument {
 		{
 			return _time();
 		}
-		constexpr std::span<const C> times() const noexcept
+		constexpr std::span<const U> times() const noexcept
 		{
 			return { _time(), _size() };
 		}
@@ -64,6 +65,13 @@ namespace fms::instrument {
 			ensure(u.size() == c.size());
 			ensure(std::is_sorted(u.begin(), u.end()));
 		}
+		// Take ownership of cash flow vectors without copying.
+		constexpr instrument(std::vector<U>&& u, std::vector<C>&& c)
+			: u(std::move(u)), c(std::move(c))
+		{
+			ensure(this->u.size() == this->c.size());
+			ensure(std::is_sorted(this->u.begin(), this->u.end()));
+		}
 		constexpr instrument(std::span<U> u, std::span<C> c)
 			: u(u.begin(), u.end()), c(c.begin(), c.end())
 		{
@@ -145,4 +153,115 @@ namespace fms::instrument {
 		bond& operator=(const bond& b) = default;
 		virtual	~bond() = default;
 	};
+
+	// Many instruments stored as a structure of arrays.
+	// All times and cash flows live in two contiguous arrays and
+	// instrument k has cash flows in [offset[k], offset[k + 1]).
+	template<class U = double, class C = double>
+	class portfolio {
+		std::vector<U> u;
+		std::vector<C> c;
+		std::vector<std::size_t> offset;
+	public:
+		// Non-owning instrument referring to cash flows in a portfolio.
+		class view : public base<U, C> {
+			const U* u;
+			const C* c;
+			std::size_t n;
+		public:
+			constexpr view(std::size_t n, const U* u, const C* c)
+				: u(u), c(c), n(n)
+			{ }
+			constexpr view(const view&) = default;
+			constexpr view& operator=(const view&) = default;
+			~view() = default;
+
+			constexpr std::size_t _size() const noexcept override
+			{
+				return n;
+			}
+			constexpr const U* _time() const noexcept override
+			{
+				return u;
+			}
+			constexpr const C* _cash() const noexcept override
+			{
+				return c;
+			}
+		};
+
+		portfolio()
+			: offset{ 0 }
+		{ }
+		portfolio(const portfolio&) = default;
+		portfolio& operator=(const portfolio&) = default;
+		portfolio(portfolio&&) = default;
+		portfolio& operator=(portfolio&&) = default;
+		~portfolio() = default;
+
+		// Reserve space for n instruments with m cash flows in total.
+		portfolio& reserve(std::size_t n, std::size_t m)
+		{
+			offset.reserve(n + 1);
+			u.reserve(m);
+			c.reserve(m);
+
+			return *this;
+		}
+
+		// Number of instruments.
+		std::size_t size() const noexcept
+		{
+			return offset.size() - 1;
+		}
+
+		// Append cash flows of an instrument.
+		portfolio& push_back(const base<U, C>& i)
+		{
+			u.insert(u.end(), i.time(), i.time() + i.size());
+			c.insert(c.end(), i.cash(), i.cash() + i.size());
+			offset.push_back(u.size());
+
+			return *this;
+		}
+
+		view operator[](std::size_t k) const
+		{
+			return view(offset[k + 1] - offset[k], u.data() + offset[k], c.data() + offset[k]);
+		}
+
+		// All cash flow times, amounts, and offsets.
+		std::span<const U> times() const noexcept
+		{
+			return u;
+		}
+		std::span<const C> cashes() const noexcept
+		{
+			return c;
+		}
+		std::span<const std::size_t> offsets() const noexcept
+		{
+			return offset;
+		}
+	};
+#ifdef _DEBUG
+	inline int portfolio_test()
+	{
+		{
+			portfolio<> p;
+			p.reserve(2, 3);
+			p.push_back(zero_coupon_bond<>(1., 2.)).push_back(bond<>(1, 0.04));
+			ensure(p.size() == 2);
+			ensure(p.times().size() == 3);
+			const auto z = p[0];
+			ensure(z.size() == 1 && z.first() == std::pair(1., 2.));
+			const auto b = p[1];
+			ensure(b.size() == 2);
+			ensure(b.time() == p.times().data() + 1);
+			ensure(b.last() == std::pair(1., 1.02));
+		}
+
+		return 0;
+	}
+#endif // _DEBUG
 } // namespace fms
\ No newline at end of file
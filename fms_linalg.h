@@ -1,23 +1,62 @@
 
 // fms_linalg.h - Generic linear algebra utilities
+/*
+	Level 2 and 3 routines on row major mdspan views. If the standard library
+	has <linalg>, or FMS_USE_STDBLAS is defined and the stdBLAS submodule is on
+	the include path, gemm and gemv without an execution policy dispatch to it.
+	stdBLAS is built on the Kokkos mdspan so it is only used when fms_mdspan.h
+	falls back to the mdspan submodule, not with a standard library <mdspan>.
+	Shapes are checked before dispatch so both paths report the same errors.
+*/
 #pragma once
-#include <numeric> // inner_product
+#include <algorithm>
+#include <cstddef>
+#include <compare>
+#include <execution>
+#include <iterator>
+#include <span>
+#include <type_traits>
+#include <vector>
+#include <version>
 #include "fms_error.h"
+#include "fms_mdspan.h"
+#if defined(__cpp_lib_linalg) && defined(__cpp_lib_mdspan)
+#include <linalg>
+#define FMS_LINALG_NAMESPACE std::linalg
+#elif defined(FMS_USE_STDBLAS) && defined(FMS_MDSPAN_KOKKOS)
+#include <experimental/linalg>
+#define FMS_LINALG_NAMESPACE MDSPAN_IMPL_STANDARD_NAMESPACE::MDSPAN_IMPL_PROPOSED_NAMESPACE::linalg
+#endif
 
 namespace fms::linalg {
 
 	// Compute the dot product of two vectors
 	// https://en.cppreference.com/w/cpp/algorithm/inner_product.html
 	// https://www.intel.com/content/www/us/en/docs/onemkl/developer-reference-c/2025-2/cblas-dot.html
+	// Four independent partial sums break the dependency chain so the loop vectorizes.
 	template<class T = double>
 	constexpr T dot(std::size_t n, const T* x, const T* y)
 	{
-		return std::inner_product(x, x + n, y, T(0));
+		T s[4] = { 0, 0, 0, 0 };
+		std::size_t i = 0;
+		for (; i + 4 <= n; i += 4) {
+			s[0] += x[i] * y[i];
+			s[1] += x[i + 1] * y[i + 1];
+			s[2] += x[i + 2] * y[i + 2];
+			s[3] += x[i + 3] * y[i + 3];
+		}
+		for (; i < n; ++i) {
+			s[0] += x[i] * y[i];
+		}
+
+		return (s[0] + s[1]) + (s[2] + s[3]);
 	}
 	namespace { // anonymous
 		constexpr double x[] = { 1.0, 2.0, 3.0 };
 		constexpr double y[] = { 3.0, 4.0, 5.0 };
 		static_assert(dot(3, x, y) == 3 + 8 + 15);
+		constexpr double z[] = { 1, 2, 3, 4, 5, 6, 7 };
+		static_assert(dot(7, z, z) == 1 + 4 + 9 + 16 + 25 + 36 + 49);
 	}
 
 	// z = a * x + y
@@ -45,4 +84,394 @@ namespace fms::linalg {
 		static_assert(test_axpy(), "axpy test failed");
 	}
 
+	// y = alpha op(A) x + beta y where op(A) is A or its transpose
+	// BLAS level 2 gemv
+	// https://www.intel.com/content/www/us/en/docs/onemkl/developer-reference-c/2025-2/cblas-gemv.html
+	template<class T>
+	inline void gemv(bool trans, T alpha, matrix<const T> A, std::span<const T> x, T beta, std::span<T> y)
+	{
+		const std::size_t m = A.extent(0), n = A.extent(1);
+		ensure(x.size() == (trans ? m : n) || !"linalg::gemv: x must have op(A) columns");
+		ensure(y.size() == (trans ? n : m) || !"linalg::gemv: y must have op(A) rows");
+
+#ifdef FMS_LINALG_NAMESPACE
+		namespace la = FMS_LINALG_NAMESPACE;
+		const mdspan<const T, dextents<std::size_t, 1>> x_(x.data(), x.size());
+		const mdspan<T, dextents<std::size_t, 1>> y_(y.data(), y.size());
+		const auto Ax = [&](auto A_) {
+			if (beta == 0) {
+				la::matrix_vector_product(la::scaled(alpha, A_), x_, y_);
+			}
+			else {
+				la::matrix_vector_product(la::scaled(alpha, A_), x_, la::scaled(beta, y_), y_);
+			}
+		};
+		trans ? Ax(la::transposed(A)) : Ax(A);
+#else
+		if (trans) {
+			// y += alpha x_i row i of A
+			for (T& y_ : y) {
+				y_ = beta == 0 ? T(0) : beta * y_;
+			}
+			for (std::size_t i = 0; i < m; ++i) {
+				axpy(n, alpha * x[i], row(A, i), y.data(), y.data());
+			}
+		}
+		else {
+			for (std::size_t i = 0; i < m; ++i) {
+				y[i] = alpha * dot(n, row(A, i), x.data()) + (beta == 0 ? T(0) : beta * y[i]);
+			}
+		}
+#endif // FMS_LINALG_NAMESPACE
+	}
+
+	// A = alpha x y' + A
+	// BLAS level 2 ger
+	// https://www.intel.com/content/www/us/en/docs/onemkl/developer-reference-c/2025-2/cblas-ger.html
+	template<class T>
+	inline void ger(T alpha, std::span<const T> x, std::span<const T> y, matrix<T> A)
+	{
+		ensure((x.size() == A.extent(0) && y.size() == A.extent(1)) || !"linalg::ger: A must be x.size() by y.size()");
+
+		for (std::size_t i = 0; i < x.size(); ++i) {
+			axpy(y.size(), alpha * x[i], y.data(), row(A, i), row(A, i));
+		}
+	}
+
+	// Solve op(A) x = b for triangular A in place of b.
+	// Only the upper or lower triangle of A is used. Unit assumes a diagonal of ones.
+	// BLAS level 2 trsv
+	// https://www.intel.com/content/www/us/en/docs/onemkl/developer-reference-c/2025-2/cblas-trsv.html
+	template<class T>
+	inline void trsv(bool upper, bool trans, bool unit, matrix<const T> A, std::span<T> x)
+	{
+		const std::size_t n = A.extent(0);
+		ensure(A.extent(1) == n || !"linalg::trsv: A must be square");
+		ensure(x.size() == n || !"linalg::trsv: x must have A rows");
+
+		if (!trans) {
+			// substitution with rows of A
+			for (std::size_t i_ = 0; i_ < n; ++i_) {
+				const std::size_t i = upper ? n - 1 - i_ : i_;
+				const T* a = row(A, i);
+				T x_ = x[i] - (upper ? dot(n - 1 - i, a + i + 1, x.data() + i + 1) : dot(i, a, x.data()));
+				x[i] = unit ? x_ : x_ / a[i];
+			}
+		}
+		else {
+			// column sweep with rows of A so memory access stays contiguous
+			for (std::size_t i_ = 0; i_ < n; ++i_) {
+				const std::size_t i = upper ? i_ : n - 1 - i_;
+				const T* a = row(A, i);
+				if (!unit) {
+					x[i] /= a[i];
+				}
+				if (upper) {
+					axpy(n - 1 - i, -x[i], a + i + 1, x.data() + i + 1, x.data() + i + 1);
+				}
+				else {
+					axpy(i, -x[i], a, x.data(), x.data());
+				}
+			}
+		}
+	}
+
+	// Cache and register blocking for gemm.
+	// Panels of op(B) (KC x NC) and blocks of op(A) (MC x KC) are packed into
+	// contiguous buffers that fit in L3 and L2. The microkernel keeps an MR x NR
+	// tile of C in registers while streaming packed A and B from L1.
+	namespace gemm_block {
+		constexpr std::size_t MR = 4, NR = 8;
+		constexpr std::size_t MC = 64, KC = 256, NC = 256;
+
+		// Buffers grow to their maximum size once per thread so gemm does not allocate after warm up.
+		template<class T>
+		inline std::vector<T>& buffer(int i)
+		{
+			thread_local std::vector<T> buf[2];
+
+			return buf[i];
+		}
+
+		// Pack the mr x kc block of op(M) at (r0, c0) into strips of R rows.
+		// Strips are stored column by column and padded with zeros to R rows.
+		template<std::size_t R, class T>
+		inline void pack(bool trans, matrix<const T> M, std::size_t r0, std::size_t mr, std::size_t c0, std::size_t kc, T* P)
+		{
+			for (std::size_t p = 0; p < mr; p += R) {
+				const std::size_t r = (std::min)(R, mr - p);
+				for (std::size_t l = 0; l < kc; ++l, P += R) {
+					for (std::size_t i = 0; i < R; ++i) {
+						P[i] = i >= r ? T(0) : trans ? row(M, c0 + l)[r0 + p + i] : row(M, r0 + p + i)[c0 + l];
+					}
+				}
+			}
+		}
+
+		// Check op(A) op(B) has the shape of C and return the inner dimension.
+		template<class T>
+		inline std::size_t shape(bool trans_a, bool trans_b, matrix<const T> A, matrix<const T> B, matrix<T> C)
+		{
+			const std::size_t m = C.extent(0), n = C.extent(1);
+			const std::size_t k = trans_a ? A.extent(0) : A.extent(1);
+			ensure((trans_a ? A.extent(1) : A.extent(0)) == m || !"linalg::gemm: op(A) must have C rows");
+			ensure((trans_b ? B.extent(0) : B.extent(1)) == n || !"linalg::gemm: op(B) must have C columns");
+			ensure((trans_b ? B.extent(1) : B.extent(0)) == k || !"linalg::gemm: op(A) columns must equal op(B) rows");
+
+			return k;
+		}
+
+		// Random access iterator over the indices 0, 1, ... so execution policies
+		// can split row blocks without allocating an index vector.
+		struct counter {
+			using iterator_category = std::random_access_iterator_tag;
+			using value_type = std::size_t;
+			using difference_type = std::ptrdiff_t;
+			using pointer = void;
+			using reference = std::size_t;
+
+			std::size_t i = 0;
+
+			std::size_t operator*() const
+			{
+				return i;
+			}
+			std::size_t operator[](difference_type n) const
+			{
+				return i + n;
+			}
+			counter& operator++()
+			{
+				++i;
+				return *this;
+			}
+			counter operator++(int)
+			{
+				return counter{ i++ };
+			}
+			counter& operator--()
+			{
+				--i;
+				return *this;
+			}
+			counter operator--(int)
+			{
+				return counter{ i-- };
+			}
+			counter& operator+=(difference_type n)
+			{
+				i += n;
+				return *this;
+			}
+			counter& operator-=(difference_type n)
+			{
+				i -= n;
+				return *this;
+			}
+			friend counter operator+(counter c, difference_type n)
+			{
+				return c += n;
+			}
+			friend counter operator+(difference_type n, counter c)
+			{
+				return c += n;
+			}
+			friend counter operator-(counter c, difference_type n)
+			{
+				return c -= n;
+			}
+			friend difference_type operator-(counter a, counter b)
+			{
+				return difference_type(a.i) - difference_type(b.i);
+			}
+			friend bool operator==(counter a, counter b) = default;
+			friend auto operator<=>(counter a, counter b) = default;
+		};
+
+		// C[i, j] += alpha sum_l a[l, i] b[l, j] for i < mr, j < nr, and kc terms.
+		// a and b are packed strips, c has row stride ldc.
+		// Portable C++ with fixed trip counts. It only uses SIMD registers when the compiler
+		// vectorizes the tile, e.g. -O3 or /O2 with -mavx2 or /arch:AVX2 as in bench/CMakeLists.txt.
+		// At plain -O2 without a target ISA expect scalar code, a few GFLOP/s.
+		template<class T>
+		inline void kernel(std::size_t kc, T alpha, const T* a, const T* b, T* c, std::size_t ldc, std::size_t mr, std::size_t nr)
+		{
+			T t[MR * NR] = {};
+			for (std::size_t l = 0; l < kc; ++l, a += MR, b += NR) {
+				for (std::size_t i = 0; i < MR; ++i) {
+					for (std::size_t j = 0; j < NR; ++j) {
+						t[i * NR + j] += a[i] * b[j];
+					}
+				}
+			}
+			for (std::size_t i = 0; i < mr; ++i) {
+				for (std::size_t j = 0; j < nr; ++j) {
+					c[i * ldc + j] += alpha * t[i * NR + j];
+				}
+			}
+		}
+	}
+
+	// C = alpha op(A) op(B) + beta C where op(A) is A or its transpose
+	// BLAS level 3 gemm on row major views
+	// https://www.intel.com/content/www/us/en/docs/onemkl/developer-reference-c/2025-2/cblas-gemm.html
+	// Row blocks of C are computed using the execution policy.
+	template<class ExecutionPolicy, class T>
+		requires std::is_execution_policy_v<std::remove_cvref_t<ExecutionPolicy>>
+	inline void gemm(ExecutionPolicy&& policy, bool trans_a, bool trans_b, T alpha,
+		matrix<const T> A, matrix<const T> B, T beta, matrix<T> C)
+	{
+		using namespace gemm_block;
+		const std::size_t m = C.extent(0), n = C.extent(1);
+		const std::size_t k = shape(trans_a, trans_b, A, B, C);
+
+		for (std::size_t i = 0; i < m; ++i) {
+			T* c = row(C, i);
+			for (std::size_t j = 0; j < n; ++j) {
+				c[j] = beta == 0 ? T(0) : beta * c[j];
+			}
+		}
+		if (alpha == 0 || k == 0) {
+			return;
+		}
+
+		const counter ib{ 0 }, ie{ (m + MC - 1) / MC }; // row blocks
+		for (std::size_t j0 = 0; j0 < n; j0 += NC) {
+			const std::size_t nc = (std::min)(NC, n - j0);
+			for (std::size_t l0 = 0; l0 < k; l0 += KC) {
+				const std::size_t kc = (std::min)(KC, k - l0);
+				// op(B) is op(A) with the roles of rows and columns swapped
+				auto& b = buffer<T>(1);
+				b.resize((std::max)(b.size(), KC * NC));
+				// op(B) panel as strips of columns, that is rows of op(B)'
+				pack<NR>(!trans_b, B, j0, nc, l0, kc, b.data());
+				std::for_each(policy, ib, ie, [&](std::size_t i_) {
+					const std::size_t i0 = i_ * MC;
+					const std::size_t mc = (std::min)(MC, m - i0);
+					auto& a = buffer<T>(0);
+					a.resize((std::max)(a.size(), MC * KC));
+					pack<MR>(trans_a, A, i0, mc, l0, kc, a.data());
+					for (std::size_t j = 0; j < nc; j += NR) {
+						for (std::size_t i = 0; i < mc; i += MR) {
+							kernel(kc, alpha, a.data() + i * kc, b.data() + j * kc, row(C, i0 + i) + j0 + j, n,
+								(std::min)(MR, mc - i), (std::min)(NR, nc - j));
+						}
+					}
+				});
+			}
+		}
+	}
+	template<class T>
+	inline void gemm(bool trans_a, bool trans_b, T alpha, matrix<const T> A, matrix<const T> B, T beta, matrix<T> C)
+	{
+#ifdef FMS_LINALG_NAMESPACE
+		namespace la = FMS_LINALG_NAMESPACE;
+		gemm_block::shape(trans_a, trans_b, A, B, C);
+		const auto AB = [&](auto A_, auto B_) {
+			if (beta == 0) {
+				la::matrix_product(la::scaled(alpha, A_), B_, C);
+			}
+			else {
+				la::matrix_product(la::scaled(alpha, A_), B_, la::scaled(beta, C), C);
+			}
+		};
+		if (trans_a) {
+			trans_b ? AB(la::transposed(A), la::transposed(B)) : AB(la::transposed(A), B);
+		}
+		else {
+			trans_b ? AB(A, la::transposed(B)) : AB(A, B);
+		}
+#else
+		gemm(std::execution::seq, trans_a, trans_b, alpha, A, B, beta, C);
+#endif // FMS_LINALG_NAMESPACE
+	}
+
+#ifdef _DEBUG
+	inline int linalg_test()
+	{
+		{
+			// blocked gemm matches the triple loop across block edges
+			const std::size_t m = 70, n = 1030, k = 260;
+			std::vector<double> A(m * k), B(k * n), C(m * n), D(m * n);
+			for (std::size_t i = 0; i < A.size(); ++i) {
+				A[i] = double(i % 7) - 3;
+			}
+			for (std::size_t i = 0; i < B.size(); ++i) {
+				B[i] = double(i % 5) - 2;
+			}
+			for (bool ta : { false, true }) {
+				for (bool tb : { false, true }) {
+					const matrix<const double> A_(A.data(), ta ? k : m, ta ? m : k);
+					const matrix<const double> B_(B.data(), tb ? n : k, tb ? k : n);
+					std::fill(C.begin(), C.end(), 1.);
+					gemm(ta, tb, 2., A_, B_, 3., matrix<double>(C.data(), m, n));
+					std::fill(D.begin(), D.end(), 1.);
+					gemm(std::execution::par, ta, tb, 2., A_, B_, 3., matrix<double>(D.data(), m, n));
+					for (std::size_t i = 0; i < m; ++i) {
+						for (std::size_t j = 0; j < n; ++j) {
+							double s = 0;
+							for (std::size_t l = 0; l < k; ++l) {
+								s += (ta ? row(A_, l)[i] : row(A_, i)[l]) * (tb ? row(B_, j)[l] : row(B_, l)[j]);
+							}
+							ensure(C[i * n + j] == 2 * s + 3);
+							ensure(D[i * n + j] == C[i * n + j]);
+						}
+					}
+				}
+			}
+		}
+		{
+			const double A[] = { 2, 0, 0,  1, 3, 0,  4, 5, 6 }; // lower triangular
+			const matrix<const double> A_(A, 3, 3);
+			const double x[] = { 1, 2, 3 };
+			double y[3] = { 1, 1, 1 };
+			gemv<double>(false, 1., A_, std::span(x), 2., std::span(y));
+			ensure(y[0] == 4 && y[1] == 9 && y[2] == 34);
+			gemv<double>(true, 1., A_, std::span(x), 0., std::span(y));
+			ensure(y[0] == 16 && y[1] == 21 && y[2] == 18);
+
+			// A x = b and A' x = b
+			for (bool trans : { false, true }) {
+				double b[3];
+				gemv<double>(trans, 1., A_, std::span(x), 0., std::span(b));
+				trsv<double>(false, trans, false, A_, std::span(b));
+				ensure(b[0] == 1 && b[1] == 2 && b[2] == 3);
+			}
+			// A' is upper triangular
+			double U[9];
+			for (std::size_t i = 0; i < 3; ++i) {
+				for (std::size_t j = 0; j < 3; ++j) {
+					U[i * 3 + j] = A[j * 3 + i];
+				}
+			}
+			for (bool trans : { false, true }) {
+				double b[3];
+				gemv<double>(trans, 1., matrix<const double>(U, 3, 3), std::span(x), 0., std::span(b));
+				trsv<double>(true, trans, false, matrix<const double>(U, 3, 3), std::span(b));
+				ensure(b[0] == 1 && b[1] == 2 && b[2] == 3);
+			}
+
+			double M[6] = {};
+			ger<double>(2., std::span(x, 2), std::span(x), matrix<double>(M, 2, 3));
+			ensure(M[0] == 2 && M[2] == 6 && M[3] == 4 && M[5] == 12);
+		}
+		{
+			// shape errors are reported with and without dispatch
+			double A[6] = {}, B[6] = {}, C[6] = {};
+			for (auto [m, n] : { std::pair<std::size_t, std::size_t>{ 3, 3 }, { 2, 2 } }) {
+				bool thrown = false;
+				try {
+					gemm(false, false, 1., matrix<const double>(A, 2, 3), matrix<const double>(B, 3, 2), 0., matrix<double>(C, m, n));
+				}
+				catch (const std::exception&) {
+					thrown = true;
+				}
+				ensure(thrown == (m != 2));
+			}
+		}
+
+		return 0;
+	}
+#endif // _DEBUG
+
 } // namespace fms::linalg	
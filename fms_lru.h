@@ -0,0 +1,106 @@
+// fms_lru.h - Thread safe least recently used cache of shared values
+#pragma once
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include "fms_error.h"
+
+namespace fms {
+
+	// At most capacity values, most recently used first.
+	template<class K, class V>
+	class lru {
+		std::size_t capacity;
+		std::mutex m;
+		std::list<std::pair<K, std::shared_ptr<const V>>> cache; // most recently used first
+
+		// Move value for k to the front of the cache. Caller holds the lock.
+		std::shared_ptr<const V> find(const K& k)
+		{
+			for (auto i = cache.begin(); i != cache.end(); ++i) {
+				if (i->first == k) {
+					cache.splice(cache.begin(), cache, i);
+
+					return cache.front().second;
+				}
+			}
+
+			return nullptr;
+		}
+	public:
+		lru(std::size_t capacity = 8)
+			: capacity(capacity ? capacity : 1)
+		{ }
+		lru(const lru&) = delete;
+		lru& operator=(const lru&) = delete;
+		~lru() = default;
+
+		// Number of cached values.
+		std::size_t size()
+		{
+			std::lock_guard<std::mutex> lock(m);
+
+			return cache.size();
+		}
+
+		// Cached value for k or make(k) on a miss.
+		template<class Make>
+		std::shared_ptr<const V> lookup(const K& k, Make&& make)
+		{
+			{
+				std::lock_guard<std::mutex> lock(m);
+				if (auto v = find(k)) {
+					return v;
+				}
+			}
+
+			std::shared_ptr<const V> v = make(k); // outside the lock so other keys are not blocked
+
+			std::lock_guard<std::mutex> lock(m);
+			// another thread may have inserted k while the value was made
+			if (auto v_ = find(k)) {
+				return v_;
+			}
+			cache.emplace_front(k, v);
+			if (cache.size() > capacity) {
+				cache.pop_back();
+			}
+
+			return v;
+		}
+	};
+
+#ifdef _DEBUG
+	inline int lru_test()
+	{
+		{
+			lru<int, int> c(2);
+			int made = 0;
+			const auto make = [&made](int k) { ++made; return std::make_shared<const int>(2 * k); };
+			ensure(*c.lookup(1, make) == 2);
+			ensure(*c.lookup(2, make) == 4);
+			ensure(*c.lookup(1, make) == 2); // hit moves 1 to the front
+			ensure(made == 2);
+			ensure(*c.lookup(3, make) == 6); // evicts 2
+			ensure(c.size() == 2);
+			ensure(made == 3);
+			ensure(*c.lookup(1, make) == 2);
+			ensure(made == 3);
+			ensure(*c.lookup(2, make) == 4);
+			ensure(made == 4);
+		}
+		{
+			lru<int, int> c(0); // at least one value
+			const auto make = [](int k) { return std::make_shared<const int>(k); };
+			c.lookup(1, make);
+			c.lookup(2, make);
+			ensure(c.size() == 1);
+		}
+
+		return 0;
+	}
+#endif // _DEBUG
+
+} // namespace fms
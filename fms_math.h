@@ -1,6 +1,11 @@
 // fms_math.h - Some constexpr math functions
 #pragma once
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
 #include <limits>
+#include <span>
 
 namespace fms::math {
 
@@ -46,14 +51,60 @@ namespace fms::math {
 		return iterations == 0 ? guess : sqrt(x, (guess + x / guess) / 2, iterations - 1);
 	}
 
+	// Write x = 4^n z with z in [1, 4) so sqrt(x) = 2^n sqrt(z) exactly.
+	// Newton from (1 + z)/2 >= sqrt(z) decreases until it stops changing.
 	template<class X>
 	constexpr X sqrt(X x) 
 	{
-		return x == 0 ? 0 : sqrt(x, x / 2, 20);
+		if (x != x || x < 0) {
+			return NaN<X>;
+		}
+		if (x == 0 || x == infinity<X>) {
+			return x;
+		}
+
+		// halve the binary exponent, 32 bits at a time first
+		constexpr X big = X(std::uint64_t(1) << 63) * 2; // 2^64
+		X z = x, y = 1;
+		while (z >= big) {
+			z /= big;
+			y *= X(std::uint64_t(1) << 32);
+		}
+		while (z < 1 / big) {
+			z *= big;
+			y /= X(std::uint64_t(1) << 32);
+		}
+		while (z >= 4) {
+			z /= 4;
+			y *= 2;
+		}
+		while (z < 1) {
+			z *= 4;
+			y /= 2;
+		}
+
+		X r = (1 + z) / 2;
+		for (X r_ = (r + z / r) / 2; r_ < r; r_ = (r + z / r) / 2) {
+			r = r_;
+		}
+
+		return y * r;
 	}
+	static_assert(sqrt(4.) == 2);
+	static_assert(sqrt(0.25) == 0.5);
+	static_assert(abs(sqrt(2.) * sqrt(2.) - 2) <= 2 * epsilon<double>);
+	static_assert(abs(sqrt(1e300) / 1e150 - 1) <= epsilon<double>);
+	static_assert(abs(sqrt(1e-300) / 1e-150 - 1) <= epsilon<double>);
+	static_assert(abs(sqrt(std::numeric_limits<double>::max()) / 1.3407807929942596e154 - 1) <= epsilon<double>);
+	static_assert(sqrt(std::numeric_limits<double>::denorm_min()) == 0x1p-537);
+	static_assert(sqrt(std::numeric_limits<double>::min()) == 0x1p-511);
+	static_assert(sqrt(infinity<double>) == infinity<double>);
+	static_assert(isnan(sqrt(-1.)));
+	static_assert(abs(sqrt(1e30f) / 1e15f - 1) <= epsilon<float>);
 
 	template<class X = double>
 	constexpr X sqrt_epsilon = sqrt(epsilon<X>);	
+	static_assert(sqrt_epsilon<double> > 1.4901161193847e-8 && sqrt_epsilon<double> < 1.4901161193848e-8);
 
 	template<class X>
 	constexpr X exp_approx(X x, int terms = 20) 
@@ -100,4 +151,219 @@ namespace fms::math {
 	static_assert(erf_as(0.0) == 0.0);
 	static_assert(erf_as(1.0) > 0.842 && erf_as(1.0) < 0.843);
 
+	// Branch free kernels for double. The span overloads are plain loops over
+	// the kernels so the compiler can vectorize them, e.g. /arch:AVX2.
+	// The rounding constants rely on /fp:precise. /fp:fast may fold (x + round) - round to x.
+
+	// exp(x) using x = n log(2) + r, |r| <= log(2)/2, and a degree 13 Taylor polynomial.
+	// Relative error is less than 2 epsilon.
+	constexpr double exp(double x)
+	{
+		constexpr double log2e = 1.4426950408889634074;
+		constexpr double ln2hi = 6.93147180369123816490e-01; // high bits of log(2)
+		constexpr double ln2lo = 1.90821492927058770002e-10; // log(2) - ln2hi
+		constexpr double round = 6755399441055744.0; // 1.5 * 2^52
+		constexpr double log_max = 709.782712893384; // log(DBL_MAX)
+
+		const double x_ = x > log_max ? log_max : x < -745.2 ? -745.2 : x;
+		const double n = (x_ * log2e + round) - round; // nearest integer
+		const double r = (x_ - n * ln2hi) - n * ln2lo;
+		// 2^n as two factors so subnormal results do not underflow early
+		const double n0 = (n * 0.5 + round) - round;
+		const double n1 = n - n0;
+
+		double p = 1. / 6227020800; // 1/13!
+		p = p * r + 1. / 479001600;
+		p = p * r + 1. / 39916800;
+		p = p * r + 1. / 3628800;
+		p = p * r + 1. / 362880;
+		p = p * r + 1. / 40320;
+		p = p * r + 1. / 5040;
+		p = p * r + 1. / 720;
+		p = p * r + 1. / 120;
+		p = p * r + 1. / 24;
+		p = p * r + 1. / 6;
+		p = p * r + 1. / 2;
+		p = p * r + 1;
+		p = p * r + 1;
+
+		// integer bits of n0 and n1 without a conversion instruction
+		const auto r0 = std::bit_cast<std::int64_t>(round);
+		const auto k0 = std::bit_cast<std::int64_t>(n0 + round) - r0;
+		const auto k1 = std::bit_cast<std::int64_t>(n1 + round) - r0;
+		const double e = p * std::bit_cast<double>((k0 + 1023) << 52) * std::bit_cast<double>((k1 + 1023) << 52);
+
+		return x != x ? x : x > log_max ? infinity<double> : x < -745.2 ? 0 : e;
+	}
+	static_assert(exp(0.) == 1);
+	static_assert(exp(-1000.) == 0);
+	static_assert(exp(709.782712893) < infinity<double>);
+	static_assert(exp(709.79) == infinity<double>);
+	static_assert(abs(exp(1.) - 2.7182818284590452354) <= 2 * epsilon<double> * 2.7182818284590452354);
+
+	// erfc(x) underflows to 0 for x > erfc_max
+	constexpr double erfc_max = 27.23;
+
+	// Complementary error function of 0.46875 <= y <= erfc_max using W. J. Cody's rational approximations.
+	// Relative error is about 1e-15.
+	constexpr double erfc_(double y)
+	{
+		constexpr double C[] = { 5.64188496988670089e-1, 8.88314979438837594e00, 6.61191906371416295e01,
+			2.98635138197400131e02, 8.81952221241769090e02, 1.71204761263407058e03, 2.05107837782607147e03,
+			1.23033935479799725e03, 2.15311535474403846e-8 };
+		constexpr double D[] = { 1.57449261107098347e01, 1.17693950891312499e02, 5.37181101862009858e02,
+			1.62138957456669019e03, 3.29079923573345963e03, 4.36261909014324716e03, 3.43936767414372164e03,
+			1.23033935480374942e03 };
+		constexpr double P[] = { 3.05326634961232344e-1, 3.60344899949804439e-1, 1.25781726111229246e-1,
+			1.60837851487422766e-2, 6.58749161529837803e-4, 1.63153871373020978e-2 };
+		constexpr double Q[] = { 2.56852019228982242e00, 1.87295284992346725e00, 5.27905102951428412e-1,
+			6.05183413124413191e-2, 2.33520497626869185e-3 };
+		constexpr double sqrt_pi = 5.6418958354775628695e-1; // 1/sqrt(pi)
+
+		// 0.46875 < y <= 4
+		double num = C[8] * y, den = y;
+		for (int i = 0; i < 7; ++i) {
+			num = (num + C[i]) * y;
+			den = (den + D[i]) * y;
+		}
+		const double mid = (num + C[7]) / (den + D[7]);
+
+		// y > 4
+		const double z = 1 / (y * y);
+		num = P[5] * z;
+		den = z;
+		for (int i = 0; i < 4; ++i) {
+			num = (num + P[i]) * z;
+			den = (den + Q[i]) * z;
+		}
+		const double big = (sqrt_pi - z * (num + P[4]) / (den + Q[4])) / y;
+
+		// exp(-y^2) without cancellation error in y^2
+		constexpr double round = 6755399441055744.0; // 1.5 * 2^52
+		const double ysq = ((y * 16 + round) - round) / 16; // few significant bits
+		const double del = (y - ysq) * (y + ysq);
+
+		return (y <= 4 ? mid : big) * exp(-ysq * ysq) * exp(-del);
+	}
+
+	// Error function using W. J. Cody's rational approximations.
+	constexpr double erf(double x)
+	{
+		constexpr double A[] = { 3.16112374387056560e00, 1.13864154151050156e02, 3.77485237685302021e02,
+			3.20937758913846947e03, 1.85777706184603153e-1 };
+		constexpr double B[] = { 2.36012909523441209e01, 2.44024637934444173e02, 1.28261652607737228e03,
+			2.84423683343917062e03 };
+
+		// |x| <= 0.46875
+		const double z = x * x;
+		double num = A[4] * z, den = z;
+		for (int i = 0; i < 3; ++i) {
+			num = (num + A[i]) * z;
+			den = (den + B[i]) * z;
+		}
+		const double small = x * (num + A[3]) / (den + B[3]);
+
+		// both branches are evaluated so loops over erf vectorize
+		const double y = abs(x);
+		const double e = 1 - erfc_(y < 0.46875 ? 0.46875 : y > erfc_max ? erfc_max : y);
+
+		return y <= 0.46875 ? small : x < 0 ? -e : e;
+	}
+	static_assert(erf(0.) == 0);
+	static_assert(abs(erf(1.) - 0.84270079294971486934) <= 2 * epsilon<double>);
+
+	// Complementary error function.
+	constexpr double erfc(double x)
+	{
+		const double y = abs(x);
+		const double e = erfc_(y < 0.46875 ? 0.46875 : y > erfc_max ? erfc_max : y);
+		const double e_ = y > erfc_max ? 0 : e; // exact tails
+
+		return y <= 0.46875 ? 1 - erf(x) : x < 0 ? 2 - e_ : e_;
+	}
+	static_assert(abs(erfc(5.) - 1.5374597944280348502e-12) <= 4 * epsilon<double> * 1.5374597944280348502e-12);
+
+	// Standard normal cumulative distribution function.
+	constexpr double normal_cdf(double x)
+	{
+		constexpr double sqrt1_2 = 0.70710678118654752440; // 1/sqrt(2)
+
+		return erfc(-x * sqrt1_2) / 2;
+	}
+	static_assert(normal_cdf(0.) == 0.5);
+	static_assert(erfc(30.) == 0 && erfc(-30.) == 2);
+	static_assert(normal_cdf(-infinity<double>) == 0 && normal_cdf(infinity<double>) == 1);
+
+	// Inverse of the standard normal cdf using P. J. Acklam's rational approximation
+	// and one Halley step. Relative error is about 1e-15.
+	// Computed from min(p, 1 - p) so normal_quantile(1 - p) = -normal_quantile(p).
+	inline double normal_quantile(double p)
+	{
+		constexpr double a[] = { -3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02,
+			1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00 };
+		constexpr double b[] = { -5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02,
+			6.680131188771972e+01, -1.328068155288572e+01 };
+		constexpr double c[] = { -7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+			-2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00 };
+		constexpr double d[] = { 7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00,
+			3.754408661907416e+00 };
+		constexpr double sqrt2pi = 2.5066282746310005024; // sqrt(2 pi)
+
+		if (!(p > 0 && p < 1)) {
+			return p == 0 ? -infinity<double> : p == 1 ? infinity<double> : NaN<double>;
+		}
+
+		const double q = p > 0.5 ? 1 - p : p; // exact for p > 0.5
+		double x;
+		if (q < 0.02425) {
+			const double r = std::sqrt(-2 * std::log(q));
+			x = (((((c[0] * r + c[1]) * r + c[2]) * r + c[3]) * r + c[4]) * r + c[5])
+				/ ((((d[0] * r + d[1]) * r + d[2]) * r + d[3]) * r + 1);
+		}
+		else {
+			const double u = q - 0.5, r = u * u;
+			x = (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * u
+				/ (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1);
+		}
+		// Halley step on normal_cdf(x) = q with x <= 0
+		const double e = normal_cdf(x) - q;
+		const double h = e * sqrt2pi * std::exp(x * x / 2);
+		x -= h / (1 + x * h / 2);
+
+		return p > 0.5 ? -x : x;
+	}
+
+	// y[j] = exp(x[j]), x and y may be the same span.
+	inline void exp(std::span<const double> x, std::span<double> y)
+	{
+		const std::size_t n = (std::min)(x.size(), y.size()); // one exit so the loop vectorizes
+		for (std::size_t j = 0; j < n; ++j) {
+			y[j] = exp(x[j]);
+		}
+	}
+	// y[j] = erf(x[j])
+	inline void erf(std::span<const double> x, std::span<double> y)
+	{
+		const std::size_t n = (std::min)(x.size(), y.size()); // one exit so the loop vectorizes
+		for (std::size_t j = 0; j < n; ++j) {
+			y[j] = erf(x[j]);
+		}
+	}
+	// y[j] = erfc(x[j])
+	inline void erfc(std::span<const double> x, std::span<double> y)
+	{
+		const std::size_t n = (std::min)(x.size(), y.size()); // one exit so the loop vectorizes
+		for (std::size_t j = 0; j < n; ++j) {
+			y[j] = erfc(x[j]);
+		}
+	}
+	// y[j] = normal_cdf(x[j])
+	inline void normal_cdf(std::span<const double> x, std::span<double> y)
+	{
+		const std::size_t n = (std::min)(x.size(), y.size()); // one exit so the loop vectorizes
+		for (std::size_t j = 0; j < n; ++j) {
+			y[j] = normal_cdf(x[j]);
+		}
+	}
+
 } // namespace fms::math
@@ -0,0 +1,32 @@
+// fms_mdspan.h - Multidimensional array views from <mdspan> or the mdspan submodule.
+#pragma once
+#include <version>
+#if defined(__cpp_lib_mdspan)
+#include <mdspan>
+#define FMS_MDSPAN_NAMESPACE std
+#else
+// submodule layout is mdspan/include/mdspan/mdspan.hpp
+#include "mdspan/include/mdspan/mdspan.hpp"
+#define FMS_MDSPAN_NAMESPACE MDSPAN_IMPL_STANDARD_NAMESPACE
+#define FMS_MDSPAN_KOKKOS // reference implementation, required by stdBLAS
+#endif
+
+namespace fms {
+
+	using FMS_MDSPAN_NAMESPACE::mdspan;
+	using FMS_MDSPAN_NAMESPACE::extents;
+	using FMS_MDSPAN_NAMESPACE::dextents;
+	using FMS_MDSPAN_NAMESPACE::layout_right;
+
+	// Row major n x m matrix view.
+	template<class T>
+	using matrix = mdspan<T, dextents<std::size_t, 2>>;
+
+	// Pointer to row i of a row major matrix.
+	template<class T>
+	constexpr T* row(const matrix<T>& a, std::size_t i)
+	{
+		return a.data_handle() + i * a.extent(1);
+	}
+
+} // namespace fms
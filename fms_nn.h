@@ -0,0 +1,391 @@
+// fms_nn.h - Feed forward neural networks with dense layers.
+/*
+	Layer l maps a batch A_l (m x n_l) to A_{l+1} = f_l(A_l W_l' + b_l)
+	where W_l is n_{l+1} x n_l. Rows are samples so forward and backward
+	passes are matrix-matrix products over the whole mini-batch.
+
+	All weights and biases live in one contiguous parameter vector with a
+	gradient vector of the same shape. Layer outputs and deltas use a
+	workspace sized for the largest batch seen so a training step does not
+	allocate once the workspace has grown.
+*/
+#pragma once
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <span>
+#include <vector>
+#include "fms_error.h"
+#include "fms_linalg.h"
+#include "fms_mdspan.h"
+
+namespace fms::nn {
+
+	enum class activation {
+		identity,
+		relu,
+		sigmoid,
+		tanh,
+		softmax, // rows sum to 1, last layer only
+	};
+
+	template<class T>
+	inline T activate(activation f, T z)
+	{
+		switch (f) {
+		case activation::relu:
+			return z > 0 ? z : T(0);
+		case activation::sigmoid:
+			return 1 / (1 + std::exp(-z));
+		case activation::tanh:
+			return std::tanh(z);
+		default:
+			return z;
+		}
+	}
+	// Derivative of f in terms of its value a = f(z).
+	template<class T>
+	inline T derivative(activation f, T a)
+	{
+		switch (f) {
+		case activation::relu:
+			return a > 0 ? T(1) : T(0);
+		case activation::sigmoid:
+			return a * (1 - a);
+		case activation::tanh:
+			return 1 - a * a;
+		default:
+			return 1;
+		}
+	}
+
+	enum class loss {
+		mse, // sum (a - y)^2 / 2
+		cross_entropy, // for sigmoid or softmax outputs
+	};
+
+	template<class T = double>
+	class network {
+		std::vector<std::size_t> n; // widths, n[0] inputs and n.back() outputs
+		std::vector<activation> f; // activation of each layer
+		std::vector<std::size_t> off; // offset of layer weights in p, biases follow
+		std::vector<T> p, g; // parameters and gradients
+		// workspace
+		std::size_t capacity = 0; // rows in workspace
+		std::vector<T> a; // layer outputs
+		std::vector<T> d0, d1; // deltas of adjacent layers
+		matrix<const T> X; // input of the last forward pass
+
+		std::size_t layers_() const
+		{
+			return f.size();
+		}
+		// Output of layer l for a batch of m rows.
+		matrix<T> out(std::size_t l, std::size_t m)
+		{
+			std::size_t o = 0;
+			for (std::size_t j = 1; j <= l; ++j) {
+				o += n[j];
+			}
+
+			return matrix<T>(a.data() + capacity * o, m, n[l + 1]);
+		}
+	public:
+		// Layer widths with inputs first and activations for each layer.
+		network(std::span<const std::size_t> width, std::span<const activation> f, std::uint64_t seed = 0)
+			: n(width.begin(), width.end()), f(f.begin(), f.end()), off(f.size() + 1)
+		{
+			ensure(n.size() >= 2 || !"nn::network: need input and output widths");
+			ensure(this->f.size() + 1 == n.size() || !"nn::network: one activation per layer");
+			for (std::size_t l = 0; l < layers_(); ++l) {
+				ensure((n[l] > 0 && n[l + 1] > 0) || !"nn::network: widths must be positive");
+				ensure(this->f[l] != activation::softmax || l + 1 == layers_() || !"nn::network: softmax must be the last layer");
+				off[l + 1] = off[l] + n[l + 1] * (n[l] + 1);
+			}
+			p.resize(off.back());
+			g.resize(off.back());
+
+			// Glorot uniform, He uniform for relu, zero biases
+			std::mt19937_64 r(seed);
+			for (std::size_t l = 0; l < layers_(); ++l) {
+				const T b = this->f[l] == activation::relu
+					? std::sqrt(T(6) / T(n[l])) : std::sqrt(T(6) / T(n[l] + n[l + 1]));
+				std::uniform_real_distribution<T> u(-b, b);
+				for (T& w : std::span<T>(p.data() + off[l], n[l + 1] * n[l])) {
+					w = u(r);
+				}
+			}
+		}
+		network(const network&) = default;
+		network& operator=(const network&) = default;
+		network(network&&) = default;
+		network& operator=(network&&) = default;
+		~network() = default;
+
+		std::size_t layers() const
+		{
+			return layers_();
+		}
+		std::size_t inputs() const
+		{
+			return n.front();
+		}
+		std::size_t outputs() const
+		{
+			return n.back();
+		}
+		// All weights and biases.
+		std::span<T> parameters()
+		{
+			return std::span<T>(p);
+		}
+		// Gradient of the loss from the last backward pass, parallel to parameters.
+		std::span<const T> gradient() const
+		{
+			return std::span<const T>(g);
+		}
+		matrix<T> weight(std::size_t l)
+		{
+			return matrix<T>(p.data() + off[l], n[l + 1], n[l]);
+		}
+		std::span<T> bias(std::size_t l)
+		{
+			return std::span<T>(p.data() + off[l] + n[l + 1] * n[l], n[l + 1]);
+		}
+
+		// Grow the workspace to hold m rows.
+		void reserve(std::size_t m)
+		{
+			if (m > capacity) {
+				std::size_t w = 0, w_ = 0;
+				for (std::size_t l = 1; l < n.size(); ++l) {
+					w += n[l];
+					w_ = (std::max)(w_, n[l]);
+				}
+				capacity = m;
+				a.resize(capacity * w);
+				d0.resize(capacity * w_);
+				d1.resize(capacity * w_);
+			}
+		}
+
+		// Outputs for the rows of X. The view is valid until the next forward pass.
+		matrix<const T> forward(matrix<const T> X)
+		{
+			ensure(X.extent(1) == n.front() || !"nn::network::forward: input width mismatch");
+			const std::size_t m = X.extent(0);
+			reserve(m);
+			this->X = X;
+
+			matrix<const T> A = X;
+			for (std::size_t l = 0; l < layers_(); ++l) {
+				matrix<T> Z = out(l, m);
+				const auto b = bias(l);
+				for (std::size_t i = 0; i < m; ++i) {
+					std::copy(b.begin(), b.end(), row(Z, i));
+				}
+				linalg::gemm(false, true, T(1), A, matrix<const T>(weight(l)), T(1), Z);
+				for (std::size_t i = 0; i < m; ++i) {
+					T* z = row(Z, i);
+					if (f[l] == activation::softmax) {
+						const T z_ = *std::max_element(z, z + n[l + 1]);
+						T s = 0;
+						for (std::size_t j = 0; j < n[l + 1]; ++j) {
+							z[j] = std::exp(z[j] - z_);
+							s += z[j];
+						}
+						for (std::size_t j = 0; j < n[l + 1]; ++j) {
+							z[j] /= s;
+						}
+					}
+					else {
+						for (std::size_t j = 0; j < n[l + 1]; ++j) {
+							z[j] = activate(f[l], z[j]);
+						}
+					}
+				}
+				A = Z;
+			}
+
+			return A;
+		}
+
+		// Gradient of the mean loss over the batch of the last forward pass given targets Y.
+		// Return the mean loss.
+		T backward(matrix<const T> Y, loss L = loss::mse)
+		{
+			const std::size_t m = X.extent(0);
+			const std::size_t K = layers_();
+			ensure((Y.extent(0) == m && Y.extent(1) == n.back()) || !"nn::network::backward: target shape mismatch");
+			ensure(L == loss::cross_entropy || f.back() != activation::softmax
+				|| !"nn::network::backward: softmax outputs need cross entropy loss");
+			ensure(L == loss::mse || f.back() == activation::sigmoid || f.back() == activation::softmax
+				|| !"nn::network::backward: cross entropy loss needs sigmoid or softmax outputs");
+
+			// delta of the last layer, d loss/d z
+			const matrix<const T> A = out(K - 1, m);
+			matrix<T> D(d0.data(), m, n.back());
+			constexpr T eps = std::numeric_limits<T>::min();
+			T loss_ = 0;
+			for (std::size_t i = 0; i < m; ++i) {
+				const T* a_ = row(A, i);
+				const T* y = row(Y, i);
+				T* d = row(D, i);
+				for (std::size_t j = 0; j < n.back(); ++j) {
+					const T e = a_[j] - y[j];
+					if (L == loss::mse) {
+						loss_ += e * e / 2;
+						d[j] = e * derivative(f.back(), a_[j]) / T(m);
+					}
+					else {
+						loss_ -= y[j] * std::log(a_[j] + eps);
+						if (f.back() == activation::sigmoid) {
+							loss_ -= (1 - y[j]) * std::log(1 - a_[j] + eps);
+						}
+						d[j] = e / T(m);
+					}
+				}
+			}
+
+			std::vector<T>* d_ = &d0;
+			for (std::size_t l = K; l-- > 0; ) {
+				D = matrix<T>(d_->data(), m, n[l + 1]);
+				const matrix<const T> A_ = l ? matrix<const T>(out(l - 1, m)) : X;
+				// dW = D' A, db = sum of rows of D
+				linalg::gemm(true, false, T(1), matrix<const T>(D), A_, T(0), matrix<T>(g.data() + off[l], n[l + 1], n[l]));
+				T* db = g.data() + off[l] + n[l + 1] * n[l];
+				std::fill(db, db + n[l + 1], T(0));
+				for (std::size_t i = 0; i < m; ++i) {
+					linalg::axpy(n[l + 1], T(1), row(D, i), db, db);
+				}
+				if (l) {
+					// D_{l-1} = D W .* f'(A)
+					std::vector<T>* e_ = d_ == &d0 ? &d1 : &d0;
+					const matrix<T> E(e_->data(), m, n[l]);
+					linalg::gemm(false, false, T(1), matrix<const T>(D), matrix<const T>(weight(l)), T(0), E);
+					for (std::size_t i = 0; i < m; ++i) {
+						const T* a_ = row(A_, i);
+						T* e = row(E, i);
+						for (std::size_t j = 0; j < n[l]; ++j) {
+							e[j] *= derivative(f[l - 1], a_[j]);
+						}
+					}
+					d_ = e_;
+				}
+			}
+
+			return loss_ / T(m);
+		}
+
+		// Gradient descent step.
+		void step(T alpha)
+		{
+			linalg::axpy(p.size(), -alpha, g.data(), p.data(), p.data());
+		}
+
+		// Mini-batch gradient descent over the rows of X and Y in order.
+		// Return the mean loss of the last epoch.
+		T train(matrix<const T> X, matrix<const T> Y, loss L = loss::mse, T alpha = T(0.1),
+			std::size_t epochs = 1, std::size_t batch = 32)
+		{
+			const std::size_t N = X.extent(0);
+			ensure(Y.extent(0) == N || !"nn::network::train: one target per row");
+			ensure(batch > 0 || !"nn::network::train: batch size must be positive");
+			reserve((std::min)(batch, N));
+
+			T loss_ = 0;
+			for (std::size_t e = 0; e < epochs; ++e) {
+				loss_ = 0;
+				for (std::size_t i = 0; i < N; i += batch) {
+					const std::size_t m = (std::min)(batch, N - i);
+					forward(matrix<const T>(row(X, i), m, X.extent(1)));
+					loss_ += backward(matrix<const T>(row(Y, i), m, Y.extent(1)), L) * T(m);
+					step(alpha);
+				}
+				loss_ /= T(N);
+			}
+
+			return loss_;
+		}
+	};
+
+#ifdef _DEBUG
+	inline int network_test()
+	{
+		{
+			// gradient matches central differences
+			const std::size_t w[] = { 3, 4, 3 };
+			const double X_[] = { 0.1, -0.2, 0.3,  0.5, 0.4, -0.6 };
+			const double Y_[] = { 1, 0, 0,  0, 0, 1 };
+			const matrix<const double> X(X_, 2, 3), Y(Y_, 2, 3);
+			for (auto [f, L] : { std::pair{ activation::sigmoid, loss::mse }, std::pair{ activation::softmax, loss::cross_entropy } }) {
+				const activation a[] = { activation::tanh, f };
+				network<> nn(std::span<const std::size_t>(w), std::span<const activation>(a), 1);
+				nn.forward(X);
+				nn.backward(Y, L);
+				const std::vector<double> g(nn.gradient().begin(), nn.gradient().end());
+				auto p = nn.parameters();
+				const double h = 1e-6;
+				for (std::size_t k = 0; k < p.size(); ++k) {
+					const double p_ = p[k];
+					p[k] = p_ + h;
+					nn.forward(X);
+					const double up = nn.backward(Y, L);
+					p[k] = p_ - h;
+					nn.forward(X);
+					const double dn = nn.backward(Y, L);
+					p[k] = p_;
+					ensure(std::fabs(g[k] - (up - dn) / (2 * h)) <= 1e-7);
+				}
+			}
+		}
+		{
+			// xor
+			const std::size_t w[] = { 2, 8, 1 };
+			const activation a[] = { activation::tanh, activation::sigmoid };
+			const double X_[] = { 0, 0,  0, 1,  1, 0,  1, 1 };
+			const double Y_[] = { 0, 1, 1, 0 };
+			const matrix<const double> X(X_, 4, 2), Y(Y_, 4, 1);
+			network<> nn(std::span<const std::size_t>(w), std::span<const activation>(a), 2);
+			const double l = nn.train(X, Y, loss::cross_entropy, 0.5, 2000, 4);
+			ensure(l < 0.05);
+			const auto A = nn.forward(X);
+			for (std::size_t i = 0; i < 4; ++i) {
+				ensure((row(A, i)[0] > 0.5) == (Y_[i] == 1));
+			}
+		}
+
+		return 0;
+	}
+
+	// A warm training epoch does not allocate.
+	// allocations() returns the number of calls to operator new so far,
+	// e.g. a counter in a replaced global operator new.
+	template<class Count>
+	inline int train_allocation_test(Count allocations)
+	{
+		const std::size_t w[] = { 20, 16, 4 };
+		const activation a[] = { activation::relu, activation::softmax };
+		const std::size_t N = 64;
+		std::vector<double> X_(N * w[0]), Y_(N * w[2]);
+		for (std::size_t i = 0; i < N; ++i) {
+			for (std::size_t j = 0; j < w[0]; ++j) {
+				X_[i * w[0] + j] = std::sin(double(i * w[0] + j));
+			}
+			Y_[i * w[2] + i % w[2]] = 1;
+		}
+		const matrix<const double> X(X_.data(), N, w[0]), Y(Y_.data(), N, w[2]);
+		network<> nn(std::span<const std::size_t>(w), std::span<const activation>(a), 3);
+		nn.train(X, Y, loss::cross_entropy, 0.1, 1, 8);
+
+		const auto n0 = allocations();
+		nn.train(X, Y, loss::cross_entropy, 0.1, 1, 8);
+		ensure(allocations() == n0);
+
+		return 0;
+	}
+#endif // _DEBUG
+
+} // namespace fms::nn
@@ -0,0 +1,181 @@
+// fms_nn_attention.h - Scaled dot-product attention with an online softmax.
+/*
+	O = softmax(Q K' / sqrt(d) + mask) V for each head.
+
+	Q is N x (h d), K is M x (h d), V is M x (h e) and O is N x (h e) where
+	head k uses columns [k d, (k + 1) d) of Q and K and [k e, (k + 1) e) of V
+	and O. The causal mask lets query i see keys j <= i + M - N so the last
+	query sees every key.
+
+	Queries are processed in tiles of BR rows against tiles of BC keys as in
+	FlashAttention. Each query row keeps its running maximum and sum of
+	exponentials so earlier partial outputs can be rescaled when a larger
+	score arrives. Only a BR x BC block of scores exists at any time and
+	scratch memory is linear in the sequence length.
+*/
+#pragma once
+#include <cmath>
+#include <algorithm>
+#include <execution>
+#include <limits>
+#include <numeric>
+#include <vector>
+#include "fms_error.h"
+#include "fms_linalg.h"
+#include "fms_mdspan.h"
+
+namespace fms::nn {
+
+	// Attention of h heads written to O. Tiles of (head, query rows) run with the execution policy.
+	template<class ExecutionPolicy, class T>
+		requires std::is_execution_policy_v<std::remove_cvref_t<ExecutionPolicy>>
+	inline void attention(ExecutionPolicy&& policy, matrix<const T> Q, matrix<const T> K, matrix<const T> V, matrix<T> O,
+		std::size_t h = 1, bool causal = false)
+	{
+		constexpr std::size_t BR = 64, BC = 128;
+		constexpr T inf = std::numeric_limits<T>::infinity();
+		const std::size_t N = Q.extent(0), M = K.extent(0);
+		ensure(h > 0 || !"nn::attention: need at least one head");
+		ensure((Q.extent(1) % h == 0 && V.extent(1) % h == 0) || !"nn::attention: columns must divide evenly into heads");
+		const std::size_t d = Q.extent(1) / h, e = V.extent(1) / h;
+		ensure(K.extent(1) == Q.extent(1) || !"nn::attention: Q and K must have the same number of columns");
+		ensure(V.extent(0) == M || !"nn::attention: K and V must have the same number of rows");
+		ensure((O.extent(0) == N && O.extent(1) == V.extent(1)) || !"nn::attention: O must have Q rows and V columns");
+		const T scale = 1 / std::sqrt(T(d));
+
+		// contiguous keys and values of each head
+		std::vector<T> K_(h * M * d), V_(h * M * e);
+		for (std::size_t j = 0; j < M; ++j) {
+			for (std::size_t k = 0; k < h; ++k) {
+				std::copy_n(row(K, j) + k * d, d, K_.data() + (k * M + j) * d);
+				std::copy_n(row(V, j) + k * e, e, V_.data() + (k * M + j) * e);
+			}
+		}
+
+		const std::size_t R = (N + BR - 1) / BR;
+		std::vector<std::size_t> t(h * R);
+		std::iota(t.begin(), t.end(), std::size_t(0));
+		std::for_each(policy, t.begin(), t.end(), [&](std::size_t t_) {
+			const std::size_t k = t_ / R;
+			const std::size_t i0 = (t_ % R) * BR;
+			const std::size_t br = (std::min)(BR, N - i0);
+			// number of keys visible to query i, clamped to [0, M]
+			const auto visible = [&](std::size_t i) {
+				const auto n = std::ptrdiff_t(i + 1 + M) - std::ptrdiff_t(N);
+				return causal ? std::size_t(std::clamp(n, std::ptrdiff_t(0), std::ptrdiff_t(M))) : M;
+			};
+			const std::size_t j1 = visible(i0 + br - 1);
+
+			std::vector<T> q(br * d), s(br * BC), o(br * e, T(0));
+			std::vector<T> m(br, -inf), l(br, T(0));
+			for (std::size_t i = 0; i < br; ++i) {
+				std::copy_n(row(Q, i0 + i) + k * d, d, q.data() + i * d);
+			}
+
+			for (std::size_t j0 = 0; j0 < j1; j0 += BC) {
+				const std::size_t bc = (std::min)(BC, j1 - j0);
+				const matrix<T> S(s.data(), br, bc);
+				linalg::gemm(false, true, scale, matrix<const T>(q.data(), br, d),
+					matrix<const T>(K_.data() + (k * M + j0) * d, bc, d), T(0), S);
+				for (std::size_t i = 0; i < br; ++i) {
+					T* s_ = row(S, i);
+					// keys j0 + c for c < c1 are visible
+					const std::size_t n_ = visible(i0 + i);
+					const std::size_t c1 = n_ > j0 ? (std::min)(bc, n_ - j0) : 0;
+					std::fill(s_ + c1, s_ + bc, -inf);
+					const T m_ = c1 ? (std::max)(m[i], *std::max_element(s_, s_ + c1)) : m[i];
+					if (m_ == -inf) {
+						std::fill(s_, s_ + bc, T(0));
+
+						continue;
+					}
+					// rescale the partial output to the new maximum
+					const T f = std::exp(m[i] - m_);
+					T l_ = 0;
+					for (std::size_t c = 0; c < c1; ++c) {
+						s_[c] = std::exp(s_[c] - m_);
+						l_ += s_[c];
+					}
+					std::fill(s_ + c1, s_ + bc, T(0));
+					if (f != 1) {
+						T* o_ = o.data() + i * e;
+						for (std::size_t c = 0; c < e; ++c) {
+							o_[c] *= f;
+						}
+					}
+					l[i] = l[i] * f + l_;
+					m[i] = m_;
+				}
+				linalg::gemm(false, false, T(1), matrix<const T>(S),
+					matrix<const T>(V_.data() + (k * M + j0) * e, bc, e), T(1), matrix<T>(o.data(), br, e));
+			}
+
+			for (std::size_t i = 0; i < br; ++i) {
+				T* O_ = row(O, i0 + i) + k * e;
+				for (std::size_t c = 0; c < e; ++c) {
+					O_[c] = l[i] > 0 ? o[i * e + c] / l[i] : T(0);
+				}
+			}
+		});
+	}
+	template<class T>
+	inline void attention(matrix<const T> Q, matrix<const T> K, matrix<const T> V, matrix<T> O,
+		std::size_t h = 1, bool causal = false)
+	{
+		attention(std::execution::par, Q, K, V, O, h, causal);
+	}
+
+#ifdef _DEBUG
+	inline int attention_test()
+	{
+		{
+			// agrees with the full softmax
+			for (auto [N, M] : { std::pair<std::size_t, std::size_t>{ 100, 100 }, { 70, 300 }, { 5, 3 } }) {
+				const std::size_t h = 2, d = 8, e = 4;
+				std::vector<double> Q(N * h * d), K(M * h * d), V(M * h * e), O(N * h * e);
+				for (std::size_t i = 0; i < Q.size(); ++i) {
+					Q[i] = std::sin(double(i));
+				}
+				for (std::size_t i = 0; i < K.size(); ++i) {
+					K[i] = std::cos(3. * double(i));
+				}
+				for (std::size_t i = 0; i < V.size(); ++i) {
+					V[i] = double(i % 11) - 5;
+				}
+				for (bool causal : { false, true }) {
+					attention(matrix<const double>(Q.data(), N, h * d), matrix<const double>(K.data(), M, h * d),
+						matrix<const double>(V.data(), M, h * e), matrix<double>(O.data(), N, h * e), h, causal);
+					for (std::size_t k = 0; k < h; ++k) {
+						for (std::size_t i = 0; i < N; ++i) {
+							std::vector<double> p(M, 0.);
+							double s = 0;
+							for (std::size_t j = 0; j < M; ++j) {
+								if (causal && j + N > i + M) {
+									continue;
+								}
+								double qk = 0;
+								for (std::size_t c = 0; c < d; ++c) {
+									qk += Q[i * h * d + k * d + c] * K[j * h * d + k * d + c];
+								}
+								p[j] = std::exp(qk / std::sqrt(double(d)));
+								s += p[j];
+							}
+							for (std::size_t c = 0; c < e; ++c) {
+								double o = 0;
+								for (std::size_t j = 0; j < M; ++j) {
+									o += p[j] * V[j * h * e + k * e + c];
+								}
+								o = s > 0 ? o / s : 0;
+								ensure(std::fabs(O[i * h * e + k * e + c] - o) <= 1e-12);
+							}
+						}
+					}
+				}
+			}
+		}
+
+		return 0;
+	}
+#endif // _DEBUG
+
+} // namespace fms::nn
@@ -9,8 +9,13 @@
 
 #pragma once
 #include <cmath>
+#include <algorithm>
 #include <limits>
+#include <span>
+#include <stdexcept>
 #include <tuple>
+#include "fms_error.h"
+#include "fms_math.h"
 #include "fms_root1d.h"
 
 namespace fms::option {
@@ -31,15 +36,93 @@ namespace fms::option {
 		{
 			return _cdf(x, s);
 		}
+		// P[j] = P_s(X < x[j]) with one virtual call for all x.
+		void cdf(std::span<const F> x, S s, std::span<T> P) const
+		{
+			ensure(x.size() == P.size() || !"option::base::cdf: x and P must have the same size");
+			_cdfs(x, s, P);
+		}
 		// Cumulant generating function
 		// kappa(s) = log E[exp(s X)]
 		S cgf(S s) const
 		{
 			return _cgf(s);
 		}
+
+		// Share density d/dx P_s(X < x)
+		T pdf(F x, S s) const
+		{
+			return _pdf(x, s);
+		}
+		// p[j] = pdf(x[j], s) with one virtual call for all x.
+		void pdf(std::span<const F> x, S s, std::span<T> p) const
+		{
+			ensure(x.size() == p.size() || !"option::base::pdf: x and p must have the same size");
+			_pdfs(x, s, p);
+		}
+		// d/ds P_s(X < x) = E[1(X < x) (X - kappa'(s)) exp(s X - kappa(s))]
+		T cdf_ds(F x, S s) const
+		{
+			return _cdf_ds(x, s);
+		}
+		// d[j] = cdf_ds(x[j], s) with one virtual call for all x.
+		void cdf_ds(std::span<const F> x, S s, std::span<T> d) const
+		{
+			ensure(x.size() == d.size() || !"option::base::cdf_ds: x and d must have the same size");
+			_cdfs_ds(x, s, d);
+		}
+		// kappa'(s) = E_s[X]
+		S cgf_ds(S s) const
+		{
+			return _cgf_ds(s);
+		}
+
+		// Smallest cdf difference the model resolves, e.g. the standard error
+		// of a simulation or the largest atom. Zero for exact continuous models.
+		T resolution(S s) const
+		{
+			return _resolution(s);
+		}
 	private:
 		virtual T _cdf(F x, S s) const = 0;
 		virtual S _cgf(S s) const = 0;
+		virtual T _resolution(S) const
+		{
+			return 0;
+		}
+		// Models that have derivatives override these. Finite differences of a
+		// noisy or step cdf are not sensitivities so there is no default.
+		virtual T _pdf(F, S) const
+		{
+			throw std::runtime_error("option::base::pdf: model does not provide a density");
+		}
+		virtual T _cdf_ds(F, S) const
+		{
+			throw std::runtime_error("option::base::cdf_ds: model does not provide d/ds of the cdf");
+		}
+		virtual S _cgf_ds(S) const
+		{
+			throw std::runtime_error("option::base::cgf_ds: model does not provide d/ds of the cgf");
+		}
+		// Models override these to share work across x.
+		virtual void _cdfs(std::span<const F> x, S s, std::span<T> P) const
+		{
+			for (std::size_t j = 0; j < x.size(); ++j) {
+				P[j] = _cdf(x[j], s);
+			}
+		}
+		virtual void _pdfs(std::span<const F> x, S s, std::span<T> p) const
+		{
+			for (std::size_t j = 0; j < x.size(); ++j) {
+				p[j] = _pdf(x[j], s);
+			}
+		}
+		virtual void _cdfs_ds(std::span<const F> x, S s, std::span<T> d) const
+		{
+			for (std::size_t j = 0; j < x.size(); ++j) {
+				d[j] = _cdf_ds(x[j], s);
+			}
+		}
 	};
 	
 	namespace black {
@@ -80,6 +163,152 @@ namespace fms::option {
 			return put(f, s, k, m) + f - k;
 		}
 
+		// Call op(j, x, P_0(X < x), P_s(X < x)) for each strike k[j] at the same forward and vol.
+		// The cgf is evaluated once and the cdfs come from the batch model API in blocks.
+		template<class F, class S, class K, class Op>
+		inline void strip(F f, S s, std::span<const K> k, const base<F, S>& m, Op&& op)
+		{
+			using T = base<F, S>::T;
+			constexpr std::size_t N = 128; // block size
+			F x[N];
+			T P0[N], Ps[N];
+
+			const S kappa = m.cgf(s);
+			const bool valid = f > 0 and s > 0;
+			for (std::size_t j0 = 0; j0 < k.size(); j0 += N) {
+				const std::size_t n = (std::min)(N, k.size() - j0);
+				for (std::size_t j = 0; j < n; ++j) {
+					const K k_ = k[j0 + j];
+					x[j] = valid and k_ > 0 ? (std::log(k_ / f) + kappa) / s : NaN<F>;
+				}
+				m.cdf(std::span<const F>(x, n), 0, std::span<T>(P0, n));
+				m.cdf(std::span<const F>(x, n), s, std::span<T>(Ps, n));
+				for (std::size_t j = 0; j < n; ++j) {
+					op(j0 + j, x[j], P0[j], Ps[j]);
+				}
+			}
+		}
+
+		// Put prices p[j] for strikes k[j].
+		template<class F = double, class S = double, class K = double>
+		inline void put_strip(F f, S s, std::span<const K> k, const base<F, S>& m, std::span<typename base<F, S>::T> p)
+		{
+			ensure(k.size() == p.size() || !"black::put_strip: strikes and prices must have the same size");
+
+			strip(f, s, k, m, [f, k, p](std::size_t j, F x, auto P0, auto Ps) {
+				p[j] = std::isnan(x) ? NaN<F> : k[j] * P0 - f * Ps;
+			});
+		}
+
+		// Call prices c[j] for strikes k[j].
+		template<class F = double, class S = double, class K = double>
+		inline void call_strip(F f, S s, std::span<const K> k, const base<F, S>& m, std::span<typename base<F, S>::T> c)
+		{
+			ensure(k.size() == c.size() || !"black::call_strip: strikes and prices must have the same size");
+
+			strip(f, s, k, m, [f, k, c](std::size_t j, F x, auto P0, auto Ps) {
+				c[j] = std::isnan(x) ? NaN<F> : k[j] * P0 - f * Ps + f - k[j];
+			});
+		}
+
+		// Value and first and second order sensitivities of an option.
+		template<class T = double>
+		struct greeks {
+			T value;
+			T delta; // d/df
+			T gamma; // d^2/df^2
+			T vega; // d/ds
+			T vanna; // d^2/df ds
+		};
+
+		// Put greeks from the moneyness, model cdf values, share density ps, dPs = d/ds P_s(X < x),
+		// and kappa_s = kappa'(s).
+		// Since k p_0(x) = f p_s(x), the terms from differentiating x cancel in delta and vega.
+		template<class F, class S, class K, class T>
+		inline greeks<T> put_greeks(F f, S s, K k, F x, T P0, T Ps, T ps, T dPs, S kappa_s)
+		{
+			if (std::isnan(x)) {
+				return { NaN<T>, NaN<T>, NaN<T>, NaN<T>, NaN<T> };
+			}
+
+			const T x_s = (kappa_s - x) / s; // dx/ds
+
+			return {
+				k * P0 - f * Ps,
+				-Ps,
+				ps / (f * s), // dx/df = -1/(f s)
+				-f * dPs,
+				-(dPs + ps * x_s)
+			};
+		}
+
+		// Put value, delta, gamma, vega, and vanna from one pass through the model.
+		template<class F = double, class S = double, class K = double>
+		inline auto put_greeks(F f, S s, K k, const base<F, S>& m)
+		{
+			using T = base<F, S>::T;
+			const auto x = moneyness(f, s, k, m);
+			if (std::isnan(x)) {
+				return greeks<T>{ NaN<T>, NaN<T>, NaN<T>, NaN<T>, NaN<T> };
+			}
+
+			return put_greeks(f, s, k, x, m.cdf(x, 0), m.cdf(x, s), m.pdf(x, s), m.cdf_ds(x, s), m.cgf_ds(s));
+		}
+
+		// Call greeks using (F - k)^+ - (k - F)^+ = F - k.
+		template<class F = double, class S = double, class K = double>
+		inline auto call_greeks(F f, S s, K k, const base<F, S>& m)
+		{
+			auto g = put_greeks(f, s, k, m);
+			g.value += f - k;
+			g.delta += 1;
+
+			return g;
+		}
+
+		// Put greeks g[j] for strikes k[j].
+		template<class F = double, class S = double, class K = double>
+		inline void greeks_strip(F f, S s, std::span<const K> k, const base<F, S>& m, std::span<greeks<typename base<F, S>::T>> g)
+		{
+			ensure(k.size() == g.size() || !"black::greeks_strip: strikes and greeks must have the same size");
+
+			// same blocks as strip with the density and vol sensitivity from batch calls
+			using T = base<F, S>::T;
+			constexpr std::size_t N = 128; // block size
+			F x[N];
+			T P0[N], Ps[N], ps[N], dPs[N];
+
+			const S kappa = m.cgf(s);
+			const S kappa_s = k.empty() ? S(0) : m.cgf_ds(s);
+			const bool valid = f > 0 and s > 0;
+			for (std::size_t j0 = 0; j0 < k.size(); j0 += N) {
+				const std::size_t n = (std::min)(N, k.size() - j0);
+				for (std::size_t j = 0; j < n; ++j) {
+					const K k_ = k[j0 + j];
+					x[j] = valid and k_ > 0 ? (std::log(k_ / f) + kappa) / s : NaN<F>;
+				}
+				const std::span<const F> x_(x, n);
+				m.cdf(x_, 0, std::span<T>(P0, n));
+				m.cdf(x_, s, std::span<T>(Ps, n));
+				m.pdf(x_, s, std::span<T>(ps, n));
+				m.cdf_ds(x_, s, std::span<T>(dPs, n));
+				for (std::size_t j = 0; j < n; ++j) {
+					g[j0 + j] = put_greeks(f, s, k[j0 + j], x[j], P0[j], Ps[j], ps[j], dPs[j], kappa_s);
+				}
+			}
+		}
+
+		// Put deltas d[j] for strikes k[j].
+		template<class F = double, class S = double, class K = double>
+		inline void delta_strip(F f, S s, std::span<const K> k, const base<F, S>& m, std::span<typename base<F, S>::T> d)
+		{
+			ensure(k.size() == d.size() || !"black::delta_strip: strikes and deltas must have the same size");
+
+			strip(f, s, k, m, [d](std::size_t j, F x, auto, auto Ps) {
+				d[j] = std::isnan(x) ? NaN<F> : -Ps;
+			});
+		}
+
 		// In the Black-Scholes/Merton model
 		// F = s0 exp(r t) exp(sigma B_t - sigma^2 t/2)
 		// In the Black model
@@ -0,0 +1,329 @@
+// fms_option_cached.h - Interpolated cdf tables in front of an expensive option model.
+/*
+	For each distinct s the wrapper tabulates cdf(x, s) on a uniform grid over
+	[s - w, s + w] and interpolates with a monotone cubic (Fritsch-Carlson) so
+	interpolated cdfs stay in [0, 1] and never decrease. The grid is doubled
+	until every midpoint is within tolerance or the grid reaches its maximum
+	size. The tolerance is raised to the model resolution, e.g. the standard
+	error of a simulation or the largest atom of a discrete model, when that
+	is below a noise limit since smaller interpolation errors are noise. If
+	the grid still fails, e.g. for a step function with few atoms, the table
+	only caches the cgf and cdf calls go to the model. Tables for the most
+	recent s are kept in an LRU so memory is bounded by capacity times the
+	maximum grid size.
+*/
+#pragma once
+#include <cmath>
+#include <algorithm>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <vector>
+#include "fms_error.h"
+#include "fms_lru.h"
+#include "fms_math.h"
+#include "fms_option.h"
+#include "fms_option_normal.h"
+#include "fms_option_discrete.h"
+#include "fms_option_monte_carlo.h"
+
+namespace fms::option {
+
+	// Assumes the lifetime of the wrapped model.
+	template<class M = base<>, class F = double, class S = double>
+		requires std::is_base_of_v<base<F, S>, M>
+	class cached : public base<F, S> {
+	public:
+		using T = typename base<F, S>::T;
+	private:
+		const M& m;
+		F w; // half width of the grid around s
+		T tol; // maximum interpolation error at grid midpoints
+		T noise; // largest model resolution accepted as tolerance
+		std::size_t max_n; // maximum number of grid intervals
+
+		struct table {
+			S s;
+			S kappa; // cgf(s)
+			bool exact; // interpolation missed tolerance, use the model
+			F a, h; // grid x_i = a + i h
+			std::vector<T> y, d; // values and slopes at grid points
+
+			T operator()(F x) const
+			{
+				const F u = (x - a) / h;
+				const std::size_t n = y.size() - 1;
+				const std::size_t i = (std::min)(static_cast<std::size_t>(u), n - 1);
+				const F t = u - F(i);
+				const F t2 = t * t, t3 = t2 * t;
+
+				return (2 * t3 - 3 * t2 + 1) * y[i] + (t3 - 2 * t2 + t) * h * d[i]
+					+ (-2 * t3 + 3 * t2) * y[i + 1] + (t3 - t2) * h * d[i + 1];
+			}
+			bool contains(F x) const
+			{
+				return a <= x && x <= a + h * F(y.size() - 1);
+			}
+		};
+		mutable lru<S, table> cache; // tables for recent s
+
+		// Models such as normal hide the base cdf.
+		const base<F, S>& interface() const
+		{
+			return m;
+		}
+
+		// Fourth order slopes limited by Fritsch-Carlson to keep monotone data monotone.
+		// Slopes have the sign of the adjacent secants, or are 0, before rescaling.
+		static void slopes(table& t)
+		{
+			const std::size_t n = t.y.size() - 1;
+			const auto& y = t.y;
+			std::vector<T> delta(n);
+			for (std::size_t i = 0; i < n; ++i) {
+				delta[i] = (y[i + 1] - y[i]) / t.h;
+			}
+			t.d.resize(n + 1);
+			t.d[0] = delta[0];
+			t.d[n] = delta[n - 1];
+			for (std::size_t i = 1; i < n; ++i) {
+				if (delta[i - 1] * delta[i] <= 0) {
+					t.d[i] = 0;
+				}
+				else if (i >= 2 && i + 2 <= n) {
+					t.d[i] = (y[i - 2] - 8 * y[i - 1] + 8 * y[i + 1] - y[i + 2]) / (12 * t.h);
+					// the stencil can turn against both neighbouring secants on step-like data
+					if (t.d[i] * delta[i] < 0) {
+						t.d[i] = 0;
+					}
+				}
+				else {
+					t.d[i] = (delta[i - 1] + delta[i]) / 2;
+				}
+			}
+			for (std::size_t i = 0; i < n; ++i) {
+				if (delta[i] == 0) {
+					t.d[i] = t.d[i + 1] = 0;
+				}
+				else {
+					const T al = t.d[i] / delta[i], be = t.d[i + 1] / delta[i];
+					const T r = al * al + be * be;
+					if (r > 9) {
+						const T tau = 3 / std::sqrt(r);
+						t.d[i] = tau * al * delta[i];
+						t.d[i + 1] = tau * be * delta[i];
+					}
+				}
+			}
+		}
+
+		std::shared_ptr<const table> make(S s) const
+		{
+			auto t = std::make_shared<table>();
+			t->s = s;
+			t->kappa = interface().cgf(s);
+			const T r = interface().resolution(s);
+			const T tol_ = (std::max)(tol, r <= noise ? r : T(0));
+			t->exact = true;
+			t->a = F(s) - w;
+
+			// batch calls let the model share work across the grid
+			std::size_t n = 16;
+			t->h = 2 * w / F(n);
+			std::vector<F> x(n + 1);
+			for (std::size_t i = 0; i <= n; ++i) {
+				x[i] = t->a + F(i) * t->h;
+			}
+			t->y.resize(n + 1);
+			interface().cdf(std::span<const F>(x), s, std::span<T>(t->y));
+			while (true) {
+				slopes(*t);
+				x.resize(n);
+				for (std::size_t i = 0; i < n; ++i) {
+					x[i] = t->a + (F(i) + F(0.5)) * t->h;
+				}
+				std::vector<T> mid(n);
+				interface().cdf(std::span<const F>(x), s, std::span<T>(mid));
+				T err = 0;
+				for (std::size_t i = 0; i < n; ++i) {
+					err = (std::max)(err, math::abs((*t)(x[i]) - mid[i]));
+				}
+				if (err <= tol_) {
+					t->exact = false;
+					break;
+				}
+				if (2 * n > max_n) {
+					t->y.clear();
+					t->d.clear();
+					break;
+				}
+				// midpoints become grid points
+				std::vector<T> y(2 * n + 1);
+				for (std::size_t i = 0; i < n; ++i) {
+					y[2 * i] = t->y[i];
+					y[2 * i + 1] = mid[i];
+				}
+				y[2 * n] = t->y[n];
+				t->y = std::move(y);
+				n *= 2;
+				t->h /= 2;
+			}
+
+			return t;
+		}
+		// Cached table for s.
+		std::shared_ptr<const table> lookup(S s) const
+		{
+			return cache.lookup(s, [this](S s_) { return make(s_); });
+		}
+	public:
+		cached(const M& m, T tol = 1e-10, F w = 8, std::size_t max_n = 1 << 12, std::size_t capacity = 8, T noise = 1e-3)
+			: m(m), w(w), tol(tol), noise(noise), max_n(max_n), cache(capacity)
+		{
+			ensure(w > 0 || !"option::cached: grid half width must be positive");
+			ensure(max_n >= 16 || !"option::cached: maximum grid size must be at least 16");
+		}
+		cached(const cached&) = delete;
+		cached& operator=(const cached&) = delete;
+		~cached() = default;
+
+		const M& model() const
+		{
+			return m;
+		}
+		// True if cdf(., s) is interpolated.
+		bool interpolated(S s) const
+		{
+			return !lookup(s)->exact;
+		}
+
+		T _cdf(F x, S s) const override
+		{
+			const auto t = lookup(s);
+
+			return t->exact || !t->contains(x) ? interface().cdf(x, s) : (*t)(x);
+		}
+		S _cgf(S s) const override
+		{
+			return lookup(s)->kappa;
+		}
+		// Sensitivities come from the model.
+		T _pdf(F x, S s) const override
+		{
+			return interface().pdf(x, s);
+		}
+		T _cdf_ds(F x, S s) const override
+		{
+			return interface().cdf_ds(x, s);
+		}
+		S _cgf_ds(S s) const override
+		{
+			return interface().cgf_ds(s);
+		}
+		void _pdfs(std::span<const F> x, S s, std::span<T> p) const override
+		{
+			interface().pdf(x, s, p);
+		}
+		void _cdfs_ds(std::span<const F> x, S s, std::span<T> d) const override
+		{
+			interface().cdf_ds(x, s, d);
+		}
+		T _resolution(S s) const override
+		{
+			return interface().resolution(s);
+		}
+		void _cdfs(std::span<const F> x, S s, std::span<T> P) const override
+		{
+			const auto t = lookup(s);
+			if (t->exact) {
+				interface().cdf(x, s, P);
+
+				return;
+			}
+			for (std::size_t j = 0; j < x.size(); ++j) {
+				P[j] = t->contains(x[j]) ? (*t)(x[j]) : interface().cdf(x[j], s);
+			}
+		}
+	};
+
+#ifdef _DEBUG
+	inline int cached_test()
+	{
+		{
+			const normal<> n;
+			const cached c(n);
+			for (double s : { 0., 0.2, 1. }) {
+				ensure(c.interpolated(s));
+				ensure(c.cgf(s) == n.cgf(s));
+				for (double x = -10; x <= 10; x += 0.37) {
+					ensure(math::abs(c.cdf(x, s) - static_cast<const base<>&>(n).cdf(x, s)) <= 1e-10);
+				}
+				ensure(math::abs(black::put(100., s + 0.1, 90., c) - black::put(100., s + 0.1, 90., n)) <= 1e-8);
+				ensure(math::abs(black::put_greeks(100., s + 0.1, 90., c).gamma - black::put_greeks(100., s + 0.1, 90., n).gamma) <= 1e-8);
+			}
+		}
+		{
+			// step functions fall back to the model
+			const double x[] = { -1, 0, 1 };
+			const double p[] = { 0.25, 0.5, 0.25 };
+			const discrete::model<> d(3, x, p);
+			const cached c(d);
+			ensure(!c.interpolated(0.1));
+			ensure(c.cdf(0.5, 0.1) == d.cdf(0.5, 0.1));
+		}
+		{
+			// step-like data stays monotone and in [0, 1]
+			struct steps : public base<> {
+				// piecewise linear through (-1, 0), (0, 0.5), (2, 0.5002), (3, 1)
+				double _cdf(double x, double) const override
+				{
+					return x <= -1 ? 0 : x <= 0 ? (x + 1) / 2 : x <= 2 ? 0.5 + 0.0001 * x : x <= 3 ? 0.5002 + 0.4998 * (x - 2) : 1;
+				}
+				double _cgf(double) const override
+				{
+					return 0;
+				}
+			} m;
+			const cached c(m, 1.); // accept the first 16 point grid with h = 1
+			ensure(c.interpolated(0.));
+			double p = 0;
+			for (double x = -8; x <= 8; x += 1. / 64) {
+				const double p_ = c.cdf(x, 0.);
+				ensure(p <= p_ && p_ <= 1);
+				p = p_;
+			}
+		}
+		{
+			// simulations interpolate to within their standard error
+			const monte_carlo<> mc(monte_carlo<>::standard_normal, 100000, 42);
+			const cached c(mc);
+			ensure(c.interpolated(0.2));
+			const double r = mc.resolution(0.2);
+			ensure(0 < r && r < 1e-3);
+			for (double x = -3; x <= 3; x += 0.25) {
+				ensure(math::abs(c.cdf(x, 0.2) - mc.cdf(x, 0.2)) <= 2 * r);
+				ensure(math::abs(c.cdf(x, 0.2) - math::normal_cdf(x - 0.2)) <= 5 * r);
+			}
+		}
+		{
+			// many atoms interpolate to within the largest atom
+			constexpr std::size_t N = 10000;
+			std::vector<double> x(N), p(N, 1.);
+			for (std::size_t i = 0; i < N; ++i) {
+				x[i] = math::normal_quantile((i + 0.5) / N);
+			}
+			const discrete::model<> d(N, x.data(), p.data());
+			const cached c(d);
+			ensure(c.interpolated(0.2));
+			const double r = d.resolution(0.2);
+			ensure(0 < r && r < 1e-3);
+			for (double x_ = -3; x_ <= 3; x_ += 0.01) {
+				ensure(math::abs(c.cdf(x_, 0.2) - d.cdf(x_, 0.2)) <= 2 * r);
+			}
+		}
+
+		return 0;
+	}
+#endif // _DEBUG
+
+} // namespace fms::option
@@ -1,14 +1,22 @@
-// fms_option_discrete.h - Discrete distribution for option pricing	
+// fms_option_discrete.h - Discrete distribution for option pricing
 #pragma once
+#include <cmath>
+#include <algorithm>
+#include <execution>
+#include <memory>
+#include <numeric>
+#include <span>
 #include <valarray>
+#include <vector>
+#include "fms_lru.h"
 #include "fms_option.h"
 
 namespace fms::option::discrete {
 	template<class F = double, class S = double>
 	class model : public option::base<F, S> {
 	public:
-		std::valarray<F> xi, pi; // P(X = xi[i]) = pi[i]
-	
+		std::valarray<F> xi, pi; // P(X = xi[i]) = pi[i], xi sorted
+
 		void normalize()
 		{
 			pi /= pi.sum(); // pi.sum() == 1
@@ -16,38 +24,236 @@ namespace fms::option::discrete {
 			xi -= Ex; // mean 0
 			xi /= std::sqrt((xi * xi * pi).sum()); // variance 1
 		}
+		// Sort support so cdf can use binary search.
+		void sort()
+		{
+			std::vector<std::size_t> i(xi.size());
+			std::iota(i.begin(), i.end(), std::size_t(0));
+			std::stable_sort(i.begin(), i.end(), [this](std::size_t j, std::size_t k) { return xi[j] < xi[k]; });
+
+			std::valarray<F> x(xi.size()), p(pi.size());
+			for (std::size_t j = 0; j < i.size(); ++j) {
+				x[j] = xi[i[j]];
+				p[j] = pi[i[j]];
+			}
+			xi = std::move(x);
+			pi = std::move(p);
+		}
+	private:
+		// Share distribution for one s.
+		struct table {
+			S s;
+			S kappa; // cgf(s)
+			std::vector<F> P; // P[i] = sum_{j < i} exp(s x_j - kappa(s)) p_j
+			std::vector<F> Q; // Q[i] = sum_{j < i} x_j exp(s x_j - kappa(s)) p_j
+		};
+		mutable lru<S, table> cache; // tables for recent s
+
+		std::shared_ptr<const table> make(S s) const
+		{
+			const std::size_t n = xi.size();
+			ensure(n > 0 || !"discrete::model: no support points");
+			auto t = std::make_shared<table>();
+			// scale by the largest exponent so exp does not overflow
+			const F x_ = s >= 0 ? xi[n - 1] : xi[0];
+
+			t->s = s;
+			t->P.resize(n + 1);
+			t->Q.resize(n + 1);
+			t->P[0] = 0;
+			t->Q[0] = 0;
+			for (std::size_t i = 0; i < n; ++i) {
+				const F w = std::exp(s * (xi[i] - x_)) * pi[i];
+				t->P[i + 1] = t->P[i] + w;
+				t->Q[i + 1] = t->Q[i] + xi[i] * w;
+			}
+			const F mgf = t->P[n];
+			for (std::size_t i = 0; i <= n; ++i) {
+				t->P[i] /= mgf;
+				t->Q[i] /= mgf;
+			}
+			t->kappa = std::log(mgf) + s * x_;
+
+			return t;
+		}
+		// Cached table for s.
+		std::shared_ptr<const table> lookup(S s) const
+		{
+			return cache.lookup(s, [this](S s_) { return make(s_); });
+		}
 	public:
-		model(std::size_t n, const F* x, const F* p)
-			: xi(x, n), pi(p, n)
+		model(std::size_t n, const F* x, const F* p, std::size_t capacity = 8)
+			: xi(x, n), pi(p, n), cache(capacity)
 		{
+			ensure(n > 0 || !"discrete::model: need at least one support point");
 			normalize();
+			sort();
 		}
-	
-		// E[exp(s X - kappa(s)) 1(X <= x) ] 
+		model(const model&) = delete;
+		model& operator=(const model&) = delete;
+		~model() = default;
+
+		// Number of cached tables.
+		std::size_t tables() const
+		{
+			return cache.size();
+		}
+
+		// E[exp(s X - kappa(s)) 1(X <= x) ]
 		//   = sum_{x_i <= x} exp(s x_i - kappa(s)) pi_i
 		F _cdf(F x, S s) const override
 		{
-			F cdf = 0;
-			for (size_t i = 0; i < xi.size() && xi[i] <= x; ++i) {
-				cdf += std::exp(s * xi[i] - _cgf(s)) * pi[i];
+			if (std::isnan(x)) {
+				return NaN<F>;
 			}
-			return cdf; // TODO: implement
+			const auto t = lookup(s);
+			const std::size_t i = std::upper_bound(std::begin(xi), std::end(xi), x) - std::begin(xi);
+
+			return t->P[i];
 		}
-	
+
 		// kappa(s) = log E[exp(s X)] = log sum p_i exp(s x_i)
 		S _cgf(S s) const override
 		{
-			S mgf = 0; // moment generating function
-			for (size_t i = 0; i < xi.size(); ++i) {
-				mgf += std::exp(s * xi[i]) * pi[i];
+			return lookup(s)->kappa;
+		}
+
+		// Largest share probability of one support point.
+		F _resolution(S s) const override
+		{
+			const auto t = lookup(s);
+			F r = 0;
+			for (std::size_t i = 0; i + 1 < t->P.size(); ++i) {
+				r = (std::max)(r, t->P[i + 1] - t->P[i]);
+			}
+
+			return r;
+		}
+
+		// The share distribution has no density between support points.
+		F _pdf(F, S) const override
+		{
+			return 0;
+		}
+		// d/ds P_s(X <= x) = sum_{x_i <= x} (x_i - kappa'(s)) exp(s x_i - kappa(s)) pi_i
+		F _cdf_ds(F x, S s) const override
+		{
+			if (std::isnan(x)) {
+				return NaN<F>;
+			}
+			const auto t = lookup(s);
+			const std::size_t i = std::upper_bound(std::begin(xi), std::end(xi), x) - std::begin(xi);
+
+			return t->Q[i] - t->Q.back() * t->P[i];
+		}
+		// kappa'(s) = E_s[X]
+		S _cgf_ds(S s) const override
+		{
+			return lookup(s)->Q.back();
+		}
+
+		// One table lookup for a strip of x.
+		void _cdfs(std::span<const F> x, S s, std::span<F> P) const override
+		{
+			const auto t = lookup(s);
+			for (std::size_t j = 0; j < x.size(); ++j) {
+				const std::size_t i = std::upper_bound(std::begin(xi), std::end(xi), x[j]) - std::begin(xi);
+				P[j] = std::isnan(x[j]) ? NaN<F> : t->P[i];
 			}
-			return std::log(mgf); // TODO: implement
 		}
 	};
+
+#ifdef _DEBUG
+	inline int model_test()
+	{
+		{
+			const double x[] = { 1, -1, 3, 0, 2 };
+			const double p[] = { 0.1, 0.3, 0.2, 0.25, 0.15 };
+			model<> m(5, x, p, 2);
+			ensure(std::is_sorted(std::begin(m.xi), std::end(m.xi)));
+			ensure(math::abs(m.pi.sum() - 1) <= 1e-15);
+			ensure(math::abs((m.xi * m.pi).sum()) <= 1e-15);
+
+			for (double s : { 0., 0.1, 0.5, -0.5, 0.1, 2., 0. }) {
+				double mgf = 0;
+				for (std::size_t i = 0; i < 5; ++i) {
+					mgf += std::exp(s * m.xi[i]) * m.pi[i];
+				}
+				const double kappa = std::log(mgf);
+				ensure(math::abs(m.cgf(s) - kappa) <= 1e-14);
+				for (double x_ : { -3., -1., 0., 0.5, 1., 3. }) {
+					double cdf = 0;
+					for (std::size_t i = 0; i < 5; ++i) {
+						if (m.xi[i] <= x_) {
+							cdf += std::exp(s * m.xi[i] - kappa) * m.pi[i];
+						}
+					}
+					ensure(math::abs(m.cdf(x_, s) - cdf) <= 1e-14);
+				}
+			}
+			ensure(m.cdf(100., 700.) == 1); // no overflow
+
+			const double k[] = { 0.5, 0.9, 1, 1.1, 2 };
+			double p_[5];
+			black::put_strip(1., 0.3, std::span<const double>(k), m, std::span<double>(p_));
+			for (std::size_t j = 0; j < 5; ++j) {
+				ensure(math::abs(p_[j] - black::put(1., 0.3, k[j], m)) <= 1e-15);
+			}
+
+			// vega and vanna match bumping when the moneyness stays between support points
+			const double h = 1e-6;
+			for (double k_ : { 0.9, 1.1 }) {
+				const auto g = black::put_greeks(1., 0.3, k_, m);
+				const auto put = [&](double f_, double s_) { return black::put(f_, s_, k_, m); };
+				ensure(math::abs(g.vega - (put(1., 0.3 + h) - put(1., 0.3 - h)) / (2 * h)) <= 1e-8);
+				ensure(math::abs(g.delta - (put(1. + h, 0.3) - put(1. - h, 0.3)) / (2 * h)) <= 1e-8);
+				ensure(math::abs(g.vanna - (put(1. + h, 0.3 + h) - put(1. + h, 0.3 - h) - put(1. - h, 0.3 + h) + put(1. - h, 0.3 - h)) / (4 * h * h)) <= 1e-4);
+				ensure(g.gamma == 0);
+			}
+		}
+		{
+			// concurrent misses on the same vols insert one table each
+			const double x[] = { 1, -1, 3, 0, 2 };
+			const double p[] = { 0.1, 0.3, 0.2, 0.25, 0.15 };
+			const model<> m(5, x, p, 8);
+			std::vector<std::size_t> i(1000);
+			std::iota(i.begin(), i.end(), std::size_t(0));
+			std::for_each(std::execution::par, i.begin(), i.end(), [&m](std::size_t i_) {
+				m.cgf(0.1 * double(i_ % 4 + 1));
+			});
+			ensure(m.tables() == 4);
+		}
+		{
+			// NaN moneyness is NaN on the scalar and strip paths
+			const double x[] = { -1, 0, 1 };
+			const double p[] = { 0.25, 0.5, 0.25 };
+			const model<> m(3, x, p);
+			const double y[] = { NaN<double> };
+			double P[1];
+			m.cdf(std::span<const double>(y), 0.1, std::span<double>(P));
+			ensure(math::isnan(P[0]));
+			ensure(math::isnan(m.cdf(NaN<double>, 0.1)));
+			ensure(math::isnan(m.cdf_ds(NaN<double>, 0.1)));
+			ensure(math::isnan(black::put(1., NaN<double>, 1., m)));
+
+			bool thrown = false;
+			try {
+				const model<> m0(0, x, p);
+			}
+			catch (const std::exception&) {
+				thrown = true;
+			}
+			ensure(thrown);
+		}
+
+		return 0;
+	}
+#endif // _DEBUG
+
 } // namespace fms::option::discrete
 
 // TODO: Create xll_option_discrete.cpp based on xll_option_normal.cpp
 // TODO: Implement add-in for \OPTION.DISCRETE
 // TODO: Implement add-in for OPTION.DISCRETE to return normalized xi values
 // TODO: Load add-in and follow comments in final.xlsx.
-// TODO: Put link to your GitHub repository on Brightspace submission.
\ No newline at end of file
+// TODO: Put link to your GitHub repository on Brightspace submission.
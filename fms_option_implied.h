@@ -0,0 +1,193 @@
+// fms_option_implied.h - Implied volatility of single quotes and full option chains.
+/*
+	Put prices are forward (undiscounted) prices p = E[(k - F)^+].
+	The initial guess is the Corrado-Miller rational approximation for the
+	normal model. It is refined by Halley steps using central differences of
+	the model put price so any option::base works. Steps that leave the
+	bracket of the root fall back to bisection.
+*/
+#pragma once
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <execution>
+#include <numbers>
+#include <numeric>
+#include <span>
+#include <vector>
+#include "fms_error.h"
+#include "fms_math.h"
+#include "fms_option.h"
+#include "fms_option_normal.h"
+#include "fms_root1d.h"
+
+namespace fms::option::black {
+
+	// Corrado-Miller approximation of vol s given put price p in the normal model.
+	template<class F = double, class S = double, class K = double>
+	inline S put_implied_guess(F f, F p, K k)
+	{
+		const F c = p + f - k; // put-call parity
+		const F d = (f - k) / 2;
+		const F q = (c - d) * (c - d) - 4 * d * d / std::numbers::pi;
+		S s = std::sqrt(2 * std::numbers::pi) / (f + k) * (c - d + std::sqrt((std::max)(q, F(0))));
+		if (!(s > 0)) {
+			s = std::sqrt(2 * std::numbers::pi) * c / f; // Brenner-Subrahmanyam
+		}
+
+		return s;
+	}
+
+	// Vol s given put price p using model m.
+	// Return NaN if p is not in the no arbitrage range (max(k - f, 0), k) or the solver fails.
+	template<class F = double, class S = double, class K = double>
+	inline S put_implied(F f, F p, K k, const base<F, S>& m,
+		S tol = math::sqrt_epsilon<S>, std::size_t iter = 100, root1d::stats<S>* sink = nullptr)
+	{
+		root1d::stats<S> st{ 0, math::NaN<S>, root1d::status::bracket };
+		if (f <= 0 || k <= 0 || !(p > (std::max)(k - f, K(0))) || !(p < k)) {
+			if (sink) {
+				*sink = st;
+			}
+			root1d::telemetry::record("put_implied", st);
+
+			return math::NaN<S>;
+		}
+
+		S lo = 0, hi = math::infinity<S>; // put is increasing in s
+		S s = put_implied_guess<F, S, K>(f, p, k);
+		S ds = math::NaN<S>;
+		std::size_t n = 0;
+		auto reason = root1d::status::iterations;
+		while (n < iter) {
+			const S y = put(f, s, k, m) - p;
+			++n;
+			if (math::abs(y) <= tol) {
+				reason = root1d::status::converged;
+				break;
+			}
+			if (y > 0) {
+				hi = s;
+			}
+			else {
+				lo = s;
+			}
+
+			const S h = (std::min)(s / 2, S(1e-4) * (std::max)(s, S(1)));
+			const S yp = put(f, s + h, k, m) - p;
+			const S ym = put(f, s - h, k, m) - p;
+			n += 2;
+			const S dy = (yp - ym) / (2 * h);
+			const S ddy = (yp - 2 * y + ym) / (h * h);
+			S s_ = s - 2 * y * dy / (2 * dy * dy - y * ddy); // Halley
+			if (!(s_ > lo && s_ < hi)) {
+				s_ = hi < math::infinity<S> ? (lo + hi) / 2 : 2 * s;
+			}
+			ds = s_ - s;
+			s = s_;
+			if (math::abs(ds) <= tol * tol) {
+				reason = hi - lo <= tol ? root1d::status::converged : root1d::status::derivative;
+				break;
+			}
+		}
+		st = { n, ds, reason };
+		if (sink) {
+			*sink = st;
+		}
+		root1d::telemetry::record("put_implied", st);
+
+		return reason == root1d::status::converged ? s : math::NaN<S>;
+	}
+	template<class F = double, class S = double, class K = double>
+	inline S put_implied(F f, F p, K k, const base<F, S>& m, root1d::stats<S>* sink)
+	{
+		return put_implied(f, p, k, m, math::sqrt_epsilon<S>, 100, sink);
+	}
+
+	// Implied vols of an option chain with expiries t[i] and forwards f[i].
+	// Strikes k[j] and put prices p[j] for offset[i] <= j < offset[i + 1] belong to expiry i.
+	// sigma[j] is the annualized vol s/sqrt(t[i]). Expiries are solved in parallel.
+	// Return the number of quotes that failed. Their vol is NaN.
+	template<class F = double, class S = double, class K = double>
+	inline std::size_t put_implied(std::span<const F> t, std::span<const F> f, std::span<const std::size_t> offset,
+		std::span<const K> k, std::span<const F> p, const base<F, S>& m, std::span<S> sigma,
+		S tol = math::sqrt_epsilon<S>, std::size_t iter = 100)
+	{
+		ensure(t.size() == f.size() || !"black::put_implied: expiries and forwards must have the same size");
+		ensure(offset.size() == t.size() + 1 || !"black::put_implied: offset must have one more element than expiries");
+		ensure((k.size() == offset.back() && p.size() == k.size() && sigma.size() == k.size())
+			|| !"black::put_implied: strikes, prices, and vols must have offset.back() elements");
+
+		std::vector<std::size_t> i(t.size());
+		std::iota(i.begin(), i.end(), std::size_t(0));
+		std::atomic<std::size_t> failed = 0;
+
+		std::for_each(std::execution::par, i.begin(), i.end(), [&](std::size_t i_) {
+			const S sqrt_t = std::sqrt(t[i_]);
+			std::size_t failed_ = 0;
+			for (std::size_t j = offset[i_]; j < offset[i_ + 1]; ++j) {
+				S s = math::NaN<S>;
+				if (t[i_] > 0) {
+					try {
+						s = put_implied(f[i_], p[j], k[j], m, tol, iter);
+					}
+					catch (...) {
+						// exceptions must not escape a parallel algorithm
+					}
+				}
+				sigma[j] = s / sqrt_t;
+				failed_ += std::isnan(s);
+			}
+			failed += failed_;
+		});
+
+		return failed;
+	}
+
+#ifdef _DEBUG
+	inline int put_implied_test()
+	{
+		{
+			const normal<> m;
+			const double f = 100;
+			for (double k : { 50., 80., 100., 120., 200. }) {
+				for (double s : { 0.01, 0.1, 0.2, 0.5, 1. }) {
+					const double p = put(f, s, k, m);
+					if (p <= (std::max)(k - f, 0.) + 1e-12) {
+						continue; // no time value left
+					}
+					root1d::stats<> st;
+					const double s_ = put_implied(f, p, k, m, &st);
+					ensure(st.reason == root1d::status::converged);
+					ensure(math::abs(put(f, s_, k, m) - p) <= math::sqrt_epsilon<>);
+				}
+			}
+			ensure(math::isnan(put_implied(f, 0., 100., m)));
+			ensure(math::isnan(put_implied(f, 100., 100., m)));
+		}
+		{
+			const normal<> m;
+			const double t[] = { 0.25, 1. };
+			const double f[] = { 100., 101. };
+			const std::size_t offset[] = { 0, 3, 5 };
+			const double k[] = { 90., 100., 110., 95., 105. };
+			const double sigma[] = { 0.25, 0.2, 0.18, 0.22, 0.19 };
+			double p[5], sigma_[5];
+			for (std::size_t i = 0; i < 2; ++i) {
+				for (std::size_t j = offset[i]; j < offset[i + 1]; ++j) {
+					p[j] = put(f[i], sigma[j] * std::sqrt(t[i]), k[j], m);
+				}
+			}
+			const auto n = put_implied(std::span<const double>(t), std::span<const double>(f), std::span<const std::size_t>(offset),
+				std::span<const double>(k), std::span<const double>(p), m, std::span<double>(sigma_));
+			ensure(n == 0);
+			for (std::size_t j = 0; j < 5; ++j) {
+				ensure(math::abs(sigma_[j] - sigma[j]) <= 1e-6);
+			}
+		}
+
+		return 0;
+	}
+#endif // _DEBUG
+
+} // namespace fms::option::black
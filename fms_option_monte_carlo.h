@@ -0,0 +1,515 @@
+// fms_option_monte_carlo.h - Option pricing model estimated from simulated X.
+/*
+	Draw i uses the Philox4x32-10 counter based generator with counter i and
+	key seed, so every draw is a pure function of (seed, i). Draws are summed
+	in fixed size chunks and chunk sums are combined in chunk order, so
+	results are bit for bit the same however chunks are spread over threads.
+
+	Each draw maps uniforms (u0, u1) and the antithetic (1 - u0, 1 - u1) to
+	samples of X using the sampler. The pair is negatively correlated when the
+	sampler is monotone in the uniforms, e.g. inversion of a cdf. Box-Muller
+	is not: cos(2 pi (1 - u1)) = cos(2 pi u1). X is a control variate with
+	known mean. It is constant over a pair for symmetric inversion samplers.
+*/
+#pragma once
+#include <cmath>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <execution>
+#include <functional>
+#include <iterator>
+#include <numbers>
+#include <numeric>
+#include <span>
+#include <vector>
+#include "fms_error.h"
+#include "fms_math.h"
+#include "fms_option.h"
+#include "fms_option_normal.h"
+
+namespace fms::option {
+
+	// Philox4x32-10 from Salmon et al, Parallel random numbers: as easy as 1, 2, 3.
+	class philox {
+		std::uint32_t k0, k1;
+
+		static constexpr void round(std::array<std::uint32_t, 4>& c, std::uint32_t k0, std::uint32_t k1)
+		{
+			const std::uint64_t p0 = std::uint64_t(0xD2511F53) * c[0];
+			const std::uint64_t p1 = std::uint64_t(0xCD9E8D57) * c[2];
+			c = {
+				std::uint32_t(p1 >> 32) ^ c[1] ^ k0,
+				std::uint32_t(p1),
+				std::uint32_t(p0 >> 32) ^ c[3] ^ k1,
+				std::uint32_t(p0)
+			};
+		}
+	public:
+		constexpr philox(std::uint64_t seed = 0)
+			: k0(std::uint32_t(seed)), k1(std::uint32_t(seed >> 32))
+		{ }
+
+		// Random bits for counter c.
+		constexpr std::array<std::uint32_t, 4> operator()(std::array<std::uint32_t, 4> c) const
+		{
+			std::uint32_t k0_ = k0, k1_ = k1;
+			for (int i = 0; i < 10; ++i) {
+				round(c, k0_, k1_);
+				k0_ += 0x9E3779B9;
+				k1_ += 0xBB67AE85;
+			}
+
+			return c;
+		}
+		// Two uniforms in (0, 1) with 53 bits for draw i.
+		constexpr std::array<double, 2> uniform(std::uint64_t i) const
+		{
+			const auto r = operator()({ std::uint32_t(i), std::uint32_t(i >> 32), 0, 0 });
+			const auto u = [](std::uint32_t a, std::uint32_t b) {
+				return ((std::uint64_t(a) << 21 | b >> 11) + 0.5) / 9007199254740992.; // 2^53
+			};
+
+			return { u(r[0], r[1]), u(r[2], r[3]) };
+		}
+	};
+	// Known answer test from the Random123 distribution.
+	static_assert(philox(0)({ 0, 0, 0, 0 })[0] == 0x6627e8d5);
+
+	// Estimate with standard error.
+	template<class T = double>
+	struct estimate {
+		T value;
+		T error;
+	};
+
+	template<class F = double, class S = double>
+	class monte_carlo : public base<F, S> {
+	public:
+		using T = typename base<F, S>::T;
+		// Map two uniforms to a sample of X.
+		using sampler = std::function<F(double, double)>;
+
+		// Standard normal by inversion so 1 - u0 gives -X.
+		static F standard_normal(double u0, double)
+		{
+			return F(math::normal_quantile(u0));
+		}
+	private:
+		sampler g;
+		std::size_t n; // number of antithetic pairs
+		philox rng;
+		F mu; // E[X], the control variate mean
+		std::size_t chunk; // pairs per chunk
+
+		// Sums over antithetic pairs of Y = 1(X <= x) e^{s X}, Z = e^{s X}, C = X, and X^2.
+		struct sums {
+			T y = 0, z = 0, c = 0, yy = 0, zz = 0, cc = 0, yz = 0, yc = 0, zc = 0, xx = 0;
+
+			sums& operator+=(const sums& s)
+			{
+				y += s.y; z += s.z; c += s.c;
+				yy += s.yy; zz += s.zz; cc += s.cc;
+				yz += s.yz; yc += s.yc; zc += s.zc;
+				xx += s.xx;
+
+				return *this;
+			}
+		};
+
+		// Sample and its antithetic for draw i.
+		std::array<F, 2> pair(std::size_t i) const
+		{
+			const auto [u0, u1] = rng.uniform(i);
+
+			return { g(u0, u1), g(1 - u0, 1 - u1) };
+		}
+
+		// Call op(k, i0, i1) for chunks k of pairs [i0, i1) in parallel and return per chunk results in order.
+		template<class R, class Op>
+		std::vector<R> chunks(Op&& op) const
+		{
+			const std::size_t K = (n + chunk - 1) / chunk;
+			std::vector<R> r(K);
+			std::vector<std::size_t> k(K);
+			std::iota(k.begin(), k.end(), std::size_t(0));
+
+			std::for_each(std::execution::par, k.begin(), k.end(), [&](std::size_t k_) {
+				r[k_] = op(k_ * chunk, (std::min)(n, (k_ + 1) * chunk));
+			});
+
+			return r;
+		}
+
+		sums accumulate(F x, S s) const
+		{
+			const auto r = chunks<sums>([this, x, s](std::size_t i0, std::size_t i1) {
+				sums a;
+				for (std::size_t i = i0; i < i1; ++i) {
+					const auto [xp, xm] = pair(i);
+					const T zp = std::exp(s * xp), zm = std::exp(s * xm);
+					const T y = ((xp <= x ? zp : 0) + (xm <= x ? zm : 0)) / 2;
+					const T z = (zp + zm) / 2;
+					const T c = (xp + xm) / 2;
+					a.y += y; a.z += z; a.c += c;
+					a.yy += y * y; a.zz += z * z; a.cc += c * c;
+					a.yz += y * z; a.yc += y * c; a.zc += z * c;
+					a.xx += (xp * xp + xm * xm) / 2;
+				}
+
+				return a;
+			});
+
+			sums a;
+			for (const auto& r_ : r) {
+				a += r_;
+			}
+
+			return a;
+		}
+		// Sums over both samples of every pair of e^{s X} times 1, X, X^2, 1(X <= x), and X 1(X <= x).
+		struct moments {
+			T z = 0, zx = 0, zxx = 0, y = 0, yx = 0;
+
+			moments& operator+=(const moments& m)
+			{
+				z += m.z; zx += m.zx; zxx += m.zxx;
+				y += m.y; yx += m.yx;
+
+				return *this;
+			}
+		};
+		moments weigh(F x, S s) const
+		{
+			const auto r = chunks<moments>([this, x, s](std::size_t i0, std::size_t i1) {
+				moments a;
+				for (std::size_t i = i0; i < i1; ++i) {
+					for (const F X : pair(i)) {
+						const T z = std::exp(s * X);
+						a.z += z;
+						a.zx += z * X;
+						a.zxx += z * X * X;
+						if (X <= x) {
+							a.y += z;
+							a.yx += z * X;
+						}
+					}
+				}
+
+				return a;
+			});
+
+			moments a;
+			for (const auto& r_ : r) {
+				a += r_;
+			}
+
+			return a;
+		}
+		// Sorted x without NaNs for binning draws.
+		static std::vector<F> sorted(std::span<const F> x)
+		{
+			std::vector<F> x_;
+			std::copy_if(x.begin(), x.end(), std::back_inserter(x_), [](F xj) { return !std::isnan(xj); });
+			std::sort(x_.begin(), x_.end());
+
+			return x_;
+		}
+	public:
+		// n draws, each an antithetic pair.
+		monte_carlo(sampler g, std::size_t n, std::uint64_t seed = 0, F mu = 0, std::size_t chunk = 1 << 16)
+			: g(std::move(g)), n(n), rng(seed), mu(mu), chunk(chunk ? chunk : 1)
+		{
+			ensure(this->g || !"option::monte_carlo: sampler must not be empty");
+			ensure(n > 1 || !"option::monte_carlo: need at least two draws");
+		}
+
+		std::size_t size() const
+		{
+			return n;
+		}
+
+		// P_s(X <= x) as a ratio of control variate estimates of E[Y] and E[Z].
+		estimate<T> cdf_estimate(F x, S s) const
+		{
+			const sums a = accumulate(x, s);
+			const T m = T(n);
+			const T Ey = a.y / m, Ez = a.z / m, Ec = a.c / m;
+			const T vc = a.cc / m - Ec * Ec;
+			const T cyc = a.yc / m - Ey * Ec, czc = a.zc / m - Ez * Ec;
+			// no control if C is constant up to rounding, e.g. symmetric inversion samplers
+			const bool control = vc > math::epsilon<T> * a.xx / m;
+			const T by = control ? cyc / vc : 0, bz = control ? czc / vc : 0;
+
+			const T y = Ey - by * (Ec - mu);
+			const T z = Ez - bz * (Ec - mu);
+			const T R = y / z;
+
+			const T vy = a.yy / m - Ey * Ey - by * cyc;
+			const T vz = a.zz / m - Ez * Ez - bz * czc;
+			const T cyz = a.yz / m - Ey * Ez - by * czc - bz * cyc + by * bz * vc;
+			const T vR = (vy - 2 * R * cyz + R * R * vz) / (z * z);
+
+			return { R, std::sqrt((std::max)(vR, T(0)) / m) };
+		}
+
+		// log E[e^{s X}]
+		estimate<S> cgf_estimate(S s) const
+		{
+			const sums a = accumulate(math::infinity<F>, s);
+			const T m = T(n);
+			const T Ez = a.z / m, Ec = a.c / m;
+			const T vc = a.cc / m - Ec * Ec;
+			const T czc = a.zc / m - Ez * Ec;
+			const T bz = vc > math::epsilon<T> * a.xx / m ? czc / vc : 0;
+			const T z = Ez - bz * (Ec - mu);
+			const T vz = a.zz / m - Ez * Ez - bz * czc;
+
+			return { S(std::log(z)), S(std::sqrt((std::max)(vz, T(0)) / m) / z) };
+		}
+
+		T _cdf(F x, S s) const override
+		{
+			return cdf_estimate(x, s).value;
+		}
+		S _cgf(S s) const override
+		{
+			return cgf_estimate(s).value;
+		}
+
+		// Standard error of the cdf near the share measure mean, x = s when Var(X) = 1,
+		// where P_s(1 - P_s) is largest.
+		T _resolution(S s) const override
+		{
+			return cdf_estimate(F(s) + mu, s).error;
+		}
+
+		// Sensitivities are estimated directly from the draws instead of
+		// differencing noisy cdf estimates.
+
+		// Share density p_s(x) using a Gaussian kernel with Silverman's bandwidth
+		// 1.06 sigma_s (2n)^{-1/5}.
+		T _pdf(F x, S s) const override
+		{
+			T p;
+			_pdfs(std::span<const F>(&x, 1), s, std::span<T>(&p, 1));
+
+			return p;
+		}
+		// Likelihood ratio d/ds P_s(X <= x) = E_s[1(X <= x) (X - kappa'(s))]
+		T _cdf_ds(F x, S s) const override
+		{
+			const moments a = weigh(x, s);
+
+			return a.yx / a.z - (a.y / a.z) * (a.zx / a.z);
+		}
+		// kappa'(s) = E_s[X]
+		S _cgf_ds(S s) const override
+		{
+			const moments a = weigh(math::infinity<F>, s);
+
+			return S(a.zx / a.z);
+		}
+
+		// One simulation for all x. Weights are binned by the sorted x and summed.
+		void _cdfs(std::span<const F> x, S s, std::span<T> P) const override
+		{
+			const std::vector<F> x_ = sorted(x);
+			const std::size_t J = x_.size();
+			// bin j holds weights with x_[j - 1] < X <= x_[j], bin J holds X > x_[J - 1]
+			const auto bin = [&x_](F X) {
+				return std::size_t(std::lower_bound(x_.begin(), x_.end(), X) - x_.begin());
+			};
+
+			const auto r = chunks<std::vector<T>>([this, s, J, &bin](std::size_t i0, std::size_t i1) {
+				std::vector<T> w(J + 1, 0);
+				for (std::size_t i = i0; i < i1; ++i) {
+					const auto [xp, xm] = pair(i);
+					w[bin(xp)] += std::exp(s * xp);
+					w[bin(xm)] += std::exp(s * xm);
+				}
+
+				return w;
+			});
+
+			std::vector<T> w(J + 1, 0);
+			for (const auto& r_ : r) {
+				for (std::size_t j = 0; j <= J; ++j) {
+					w[j] += r_[j];
+				}
+			}
+			std::partial_sum(w.begin(), w.end(), w.begin());
+			for (std::size_t j = 0; j < x.size(); ++j) {
+				P[j] = std::isnan(x[j]) ? NaN<T> : w[std::lower_bound(x_.begin(), x_.end(), x[j]) - x_.begin()] / w[J];
+			}
+		}
+		// One simulation for the bandwidth and one for the kernel sums at all x.
+		// Kernels are cut off at 8 bandwidths where they are below 1e-13.
+		void _pdfs(std::span<const F> x, S s, std::span<T> p) const override
+		{
+			const moments a = weigh(math::infinity<F>, s);
+			const T m = a.zx / a.z;
+			const T sigma = std::sqrt((std::max)(a.zxx / a.z - m * m, T(0)));
+			const F h = F(1.06 * sigma * std::pow(2. * double(n), -0.2));
+			if (!(h > 0)) {
+				std::fill(p.begin(), p.end(), NaN<T>);
+
+				return;
+			}
+			const std::vector<F> x_ = sorted(x);
+			const std::size_t J = x_.size();
+
+			const auto r = chunks<std::vector<T>>([this, s, h, J, &x_](std::size_t i0, std::size_t i1) {
+				std::vector<T> k(J, 0);
+				for (std::size_t i = i0; i < i1; ++i) {
+					for (const F X : pair(i)) {
+						const T z = std::exp(s * X);
+						const auto j1 = std::upper_bound(x_.begin(), x_.end(), X + 8 * h);
+						for (auto j = std::lower_bound(x_.begin(), x_.end(), X - 8 * h); j != j1; ++j) {
+							const T u = (*j - X) / h;
+							k[j - x_.begin()] += z * std::exp(-u * u / 2);
+						}
+					}
+				}
+
+				return k;
+			});
+
+			std::vector<T> k(J, 0);
+			for (const auto& r_ : r) {
+				for (std::size_t j = 0; j < J; ++j) {
+					k[j] += r_[j];
+				}
+			}
+			const T c = a.z * h * std::sqrt(2 * std::numbers::pi);
+			for (std::size_t j = 0; j < x.size(); ++j) {
+				p[j] = std::isnan(x[j]) ? NaN<T> : k[std::lower_bound(x_.begin(), x_.end(), x[j]) - x_.begin()] / c;
+			}
+		}
+		// One simulation for all x. Weights and X weights are binned as in _cdfs.
+		void _cdfs_ds(std::span<const F> x, S s, std::span<T> d) const override
+		{
+			const std::vector<F> x_ = sorted(x);
+			const std::size_t J = x_.size();
+			const auto bin = [&x_](F X) {
+				return std::size_t(std::lower_bound(x_.begin(), x_.end(), X) - x_.begin());
+			};
+
+			// w[2 j] sums e^{s X} and w[2 j + 1] sums X e^{s X} in bin j
+			const auto r = chunks<std::vector<T>>([this, s, J, &bin](std::size_t i0, std::size_t i1) {
+				std::vector<T> w(2 * (J + 1), 0);
+				for (std::size_t i = i0; i < i1; ++i) {
+					for (const F X : pair(i)) {
+						const T z = std::exp(s * X);
+						const std::size_t b = bin(X);
+						w[2 * b] += z;
+						w[2 * b + 1] += z * X;
+					}
+				}
+
+				return w;
+			});
+
+			std::vector<T> w(2 * (J + 1), 0);
+			for (const auto& r_ : r) {
+				for (std::size_t j = 0; j < w.size(); ++j) {
+					w[j] += r_[j];
+				}
+			}
+			for (std::size_t j = 1; j <= J; ++j) {
+				w[2 * j] += w[2 * j - 2];
+				w[2 * j + 1] += w[2 * j - 1];
+			}
+			const T z = w[2 * J], zx = w[2 * J + 1];
+			for (std::size_t j = 0; j < x.size(); ++j) {
+				if (std::isnan(x[j])) {
+					d[j] = NaN<T>;
+				}
+				else {
+					const std::size_t b = std::lower_bound(x_.begin(), x_.end(), x[j]) - x_.begin();
+					d[j] = w[2 * b + 1] / z - (w[2 * b] / z) * (zx / z);
+				}
+			}
+		}
+	};
+
+#ifdef _DEBUG
+	inline int monte_carlo_test()
+	{
+		{
+			constexpr philox p(123);
+			static_assert(p.uniform(7)[0] > 0 && p.uniform(7)[0] < 1);
+			static_assert(p.uniform(7)[1] == philox(123).uniform(7)[1]);
+		}
+		{
+			// antithetic pairs of monotone functions of X have less variance than independent pairs
+			const philox p(7);
+			const auto g = monte_carlo<>::standard_normal;
+			constexpr std::size_t N = 10000;
+			for (const auto& f : { std::function<double(double)>([](double x) { return std::exp(0.2 * x); }),
+				std::function<double(double)>([](double x) { return x > 0 ? x : 0; }) }) {
+				double a = 0, aa = 0, b = 0, bb = 0;
+				for (std::size_t i = 0; i < N; ++i) {
+					const auto [u0, u1] = p.uniform(i);
+					const auto [v0, v1] = p.uniform(N + i);
+					const double xp = g(u0, u1), xm = g(1 - u0, 1 - u1);
+					ensure(math::abs(xp + xm) <= 1e-12 * (1 + math::abs(xp)));
+					const double a_ = (f(xp) + f(xm)) / 2, b_ = (f(xp) + f(g(v0, v1))) / 2;
+					a += a_; aa += a_ * a_;
+					b += b_; bb += b_ * b_;
+				}
+				const double va = aa / N - (a / N) * (a / N), vb = bb / N - (b / N) * (b / N);
+				ensure(va < vb);
+			}
+		}
+		{
+			const monte_carlo<> m(monte_carlo<>::standard_normal, 100000, 42, 0, 1000);
+			const monte_carlo<> m2(monte_carlo<>::standard_normal, 100000, 42, 0, 1000);
+			for (double s : { 0., 0.2 }) {
+				const auto k = m.cgf_estimate(s);
+				ensure(math::abs(k.value - s * s / 2) <= 5 * k.error + 1e-12);
+				for (double x : { -1., 0., 1. }) {
+					const auto e = m.cdf_estimate(x, s);
+					ensure(e.value == m2.cdf_estimate(x, s).value); // reproducible
+					ensure(math::abs(e.value - math::normal_cdf(x - s)) <= 5 * e.error);
+				}
+			}
+			const double x[] = { 1., -1., 0. };
+			double P[3];
+			m.cdf(std::span<const double>(x), 0.2, std::span<double>(P));
+			for (std::size_t j = 0; j < 3; ++j) {
+				const auto e = m.cdf_estimate(x[j], 0.2);
+				ensure(math::abs(P[j] - e.value) <= 5 * e.error);
+			}
+
+			// greeks from the draws agree with the normal model
+			const normal<> n;
+			for (double k : { 80., 100., 120. }) {
+				const auto g = black::put_greeks(100., 0.2, k, m);
+				const auto h = black::put_greeks(100., 0.2, k, n);
+				ensure(math::abs(g.delta - h.delta) <= 0.01);
+				ensure(math::abs(g.gamma - h.gamma) <= 0.03 * h.gamma);
+				ensure(math::abs(g.vega - h.vega) <= 0.03 * h.vega);
+				ensure(math::abs(g.vanna - h.vanna) <= 0.05);
+			}
+
+			// the strip shares simulations across strikes and matches strike by strike greeks
+			const double k[] = { 80., 100., 120., -1. };
+			black::greeks<> g[4];
+			black::greeks_strip(100., 0.2, std::span<const double>(k), m, std::span(g));
+			for (std::size_t j = 0; j < 3; ++j) {
+				const auto g_ = black::put_greeks(100., 0.2, k[j], m);
+				ensure(math::abs(g[j].value - g_.value) <= 1e-12);
+				ensure(math::abs(g[j].delta - g_.delta) <= 1e-12);
+				ensure(math::abs(g[j].gamma - g_.gamma) <= 1e-12);
+				ensure(math::abs(g[j].vega - g_.vega) <= 1e-10);
+				ensure(math::abs(g[j].vanna - g_.vanna) <= 1e-10);
+			}
+			ensure(math::isnan(g[3].value) && math::isnan(g[3].gamma));
+		}
+
+		return 0;
+	}
+#endif // _DEBUG
+
+} // namespace fms::option
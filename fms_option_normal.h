@@ -2,6 +2,7 @@
 #pragma once
 #include <cmath>
 #include <numbers>
+#include <span>
 #include "fms_math.h"
 #include "fms_option.h"
 
@@ -13,8 +14,7 @@ namespace fms::option {
 		// Standard normal cumulative distribution function
 		static X cdf(X x)
 		{
-			//return 0.5 * (1 + math::erf_as(x / std::numbers::sqrt2));
-			return 0.5 * (1 + std::erf(x / std::numbers::sqrt2));
+			return math::normal_cdf(x);
 		}
 	public:
 		// cumulative distribution function
@@ -27,18 +27,73 @@ namespace fms::option {
 		{
 			return s * s /2;
 		}
+		// d/dx Phi(x - s)
+		X _pdf(X x, S s) const override
+		{
+			return std::exp(-(x - s) * (x - s) / 2) / std::sqrt(2 * std::numbers::pi);
+		}
+		// d/ds Phi(x - s)
+		X _cdf_ds(X x, S s) const override
+		{
+			return -_pdf(x, s);
+		}
+		S _cgf_ds(S s) const override
+		{
+			return s;
+		}
+		// One virtual call for a strip of x using the vectorized kernel.
+		void _cdfs(std::span<const X> x, S s, std::span<X> P) const override
+		{
+			for (std::size_t j = 0; j < x.size(); ++j) {
+				P[j] = x[j] - s;
+			}
+			math::normal_cdf(P, P);
+		}
 	};
 
-	namespace black {
-		// Vol s given put price p
-		template<class F = double, class S = double, class K = double>
-		inline F put_implied(F f, F p, K k, const base<F, S>& m)
+#ifdef _DEBUG
+	inline int strip_test()
+	{
 		{
-			auto g = [f, p, k](S s) { return put(f, s, k, normal<F>()) - p; };
-			auto res = root1d::secant<>(.1, .11).solve(g);
-
-			return get<0>(res);
+			const normal<> m;
+			const double f = 100, s = 0.2;
+			const double k[] = { 0, 80, 90, 100, 110, 120 };
+			double p[6], c[6], d[6];
+			black::put_strip(f, s, std::span<const double>(k), m, std::span<double>(p));
+			black::call_strip(f, s, std::span<const double>(k), m, std::span<double>(c));
+			black::delta_strip(f, s, std::span<const double>(k), m, std::span<double>(d));
+			ensure(math::isnan(p[0]) && math::isnan(c[0]) && math::isnan(d[0]));
+			for (std::size_t j = 1; j < 6; ++j) {
+				ensure(p[j] == black::put(f, s, k[j], m));
+				ensure(math::abs(c[j] - black::call(f, s, k[j], m)) <= 1e-13);
+				ensure(d[j] == black::put_delta(f, s, k[j], m));
+			}
 		}
+		{
+			const normal<> m;
+			const double f = 100, s = 0.2, h = 1e-4;
+			for (double k : { 80., 100., 120. }) {
+				const auto g = black::put_greeks(f, s, k, m);
+				const auto put = [&](double f_, double s_) { return black::put(f_, s_, k, m); };
+				ensure(g.value == put(f, s));
+				ensure(math::abs(g.delta - (put(f + h, s) - put(f - h, s)) / (2 * h)) <= 1e-6);
+				ensure(math::abs(g.gamma - (put(f + h, s) - 2 * g.value + put(f - h, s)) / (h * h)) <= 1e-4);
+				ensure(math::abs(g.vega - (put(f, s + h) - put(f, s - h)) / (2 * h)) <= 1e-5);
+				ensure(math::abs(g.vanna - (put(f + h, s + h) - put(f + h, s - h) - put(f - h, s + h) + put(f - h, s - h)) / (4 * h * h)) <= 1e-4);
+				const auto c = black::call_greeks(f, s, k, m);
+				ensure(c.delta == g.delta + 1 && c.vega == g.vega);
+			}
+			const double k[] = { 80., 100., 120. };
+			black::greeks<> g[3];
+			black::greeks_strip(f, s, std::span<const double>(k), m, std::span<black::greeks<>>(g));
+			for (std::size_t j = 0; j < 3; ++j) {
+				const auto g_ = black::put_greeks(f, s, k[j], m);
+				ensure(g[j].value == g_.value && g[j].gamma == g_.gamma && g[j].vanna == g_.vanna);
+			}
+		}
+
+		return 0;
 	}
+#endif // _DEBUG
 
-} // namespace fms::option::black
+} // namespace fms::option
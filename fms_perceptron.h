@@ -4,10 +4,19 @@
 // w.x < 0 for x in S_0 and w.x > 0 for x in S_1.
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <execution>
+#include <numeric>
+#include <memory>
+#include <random>
 #include <span>
+#include <thread>
 #include <vector>
 #include "fms_error.h"
 #include "fms_linalg.h"
+#include "fms_mdspan.h"
 // https://cppreference.net/cpp/numeric/linalg.html
 // #include <linalg>
 
@@ -44,6 +53,264 @@ namespace fms::perceptron {
 		return N - M; // number of iterations
     }
 
+    // Which weights fit returns.
+    enum class weights {
+        last, // weights after the last update
+        averaged, // average of the weights after every sample
+        pocket, // weights with the longest run of correct classifications
+    };
+
+    template<class T = double>
+    struct options {
+        T alpha = 1; // learning rate
+        std::size_t epochs = 100; // maximum passes over the data
+        bool shuffle = false; // visit rows in a random order each epoch
+        std::uint64_t seed = 0; // for shuffle
+        perceptron::weights weights = weights::last;
+    };
+
+    struct result {
+        std::size_t epochs; // passes over the data
+        std::size_t errors; // misclassified rows in the last pass
+    };
+
+    // Train w on the rows of X with labels y.
+    // Stop early after a pass with no errors.
+    template<class T = double>
+    inline result fit(matrix<const T> X, std::span<const bool> y, std::span<T> w, const options<T>& o = {})
+    {
+        const std::size_t N = X.extent(0);
+        const std::size_t n = X.extent(1);
+        ensure(y.size() == N || !"perceptron::fit: one label per row");
+        ensure(w.size() == n || !"perceptron::fit: one weight per column");
+
+        std::vector<std::size_t> i(N);
+        std::iota(i.begin(), i.end(), std::size_t(0));
+        std::mt19937_64 g(o.seed);
+
+        // averaged weights are w - u/c where u accumulates c times each update
+        std::vector<T> u(o.weights == weights::averaged ? n : 0);
+        T c = 1;
+        // pocket weights and their run of correct classifications
+        std::vector<T> p(o.weights == weights::pocket ? n : 0);
+        std::size_t run = 0, best = 0;
+
+        result r{ 0, N };
+        while (r.epochs < o.epochs && r.errors) {
+            if (o.shuffle) {
+                std::shuffle(i.begin(), i.end(), g);
+            }
+            r.errors = 0;
+            for (const std::size_t k : i) {
+                const T* x = row(X, k);
+                const bool y_ = linalg::dot(n, w.data(), x) > 0; // 1(w . x > 0)
+                if (y_ != y[k]) {
+                    const T a = o.alpha * (T(y[k]) - T(y_));
+                    linalg::axpy(n, a, x, w.data(), w.data());
+                    if (!u.empty()) {
+                        linalg::axpy(n, c * a, x, u.data(), u.data());
+                    }
+                    ++r.errors;
+                    run = 0;
+                }
+                else if (!p.empty() && ++run > best) {
+                    best = run;
+                    std::copy(w.begin(), w.end(), p.begin());
+                }
+                c += 1;
+            }
+            ++r.epochs;
+        }
+
+        if (!u.empty()) {
+            linalg::axpy(n, -1 / c, u.data(), w.data(), w.data());
+        }
+        else if (!p.empty() && best > 0 && r.errors) {
+            std::copy(p.begin(), p.end(), w.begin());
+        }
+
+        return r;
+    }
+
+#ifdef _DEBUG
+    inline int fit_test()
+    {
+        {
+            // separable by x0 - x1 > 0
+            const double X[] = { 2, 1,  1, 2,  3, 1,  1, 3,  2, -1,  -1, 2 };
+            const bool y[] = { true, false, true, false, true, false };
+            for (auto wt : { weights::last, weights::averaged, weights::pocket }) {
+                for (bool shuffle : { false, true }) {
+                    double w[2] = { 0, 0 };
+                    options<> o;
+                    o.shuffle = shuffle;
+                    o.weights = wt;
+                    const auto r = fit(matrix<const double>(X, 6, 2), std::span<const bool>(y), std::span<double>(w), o);
+                    ensure(r.errors == 0 && r.epochs < o.epochs);
+                    for (std::size_t k = 0; k < 6; ++k) {
+                        ensure((linalg::dot(2, w, X + 2 * k) > 0) == y[k]);
+                    }
+                }
+            }
+        }
+
+        return 0;
+    }
+#endif // _DEBUG
+
+    template<class T = double>
+    struct parallel_options : options<T> {
+        // Shards used by deterministic mode when shards is 0 so results do not depend on the machine.
+        static constexpr std::size_t deterministic_shards = 8;
+
+        std::size_t shards = 0; // contiguous blocks of rows trained concurrently, 0 for one per core or deterministic_shards
+        bool deterministic = false; // merge per shard deltas in shard order after each epoch
+    };
+
+    // Train w on the rows of X in parallel. Returns the last weights.
+    // Hogwild: every shard reads and updates the shared weights with relaxed atomics, no locks.
+    // Deterministic: every shard trains a private copy starting from w and the average
+    // of their deltas is added to w after each epoch (iterative parameter mixing).
+    // The result only depends on the number of shards, not on thread scheduling or core count.
+    template<class T = double>
+    inline result fit_parallel(matrix<const T> X, std::span<const bool> y, std::span<T> w, const parallel_options<T>& o = {})
+    {
+        const std::size_t N = X.extent(0);
+        const std::size_t n = X.extent(1);
+        ensure(y.size() == N || !"perceptron::fit_parallel: one label per row");
+        ensure(w.size() == n || !"perceptron::fit_parallel: one weight per column");
+        ensure(o.weights == weights::last || !"perceptron::fit_parallel: only last weights are supported");
+
+        std::size_t S = o.shards ? o.shards
+            : o.deterministic ? parallel_options<T>::deterministic_shards
+            : (std::max)(std::thread::hardware_concurrency(), 1u);
+        S = (std::max)(std::size_t(1), (std::min)(S, N));
+        std::vector<std::size_t> s(S);
+        std::iota(s.begin(), s.end(), std::size_t(0));
+
+        // rows of each shard in visiting order and a generator seeded by shard
+        std::vector<std::vector<std::size_t>> rows(S);
+        std::vector<std::mt19937_64> g;
+        for (std::size_t k = 0; k < S; ++k) {
+            rows[k].resize((k + 1) * N / S - k * N / S);
+            std::iota(rows[k].begin(), rows[k].end(), k * N / S);
+            g.emplace_back(o.seed + k);
+        }
+        // private weights for deterministic mode
+        std::vector<std::vector<T>> d(o.deterministic ? S : 0, std::vector<T>(n));
+
+        result r{ 0, N };
+        while (r.epochs < o.epochs && r.errors) {
+            std::atomic<std::size_t> errors = 0;
+            std::for_each(std::execution::par, s.begin(), s.end(), [&](std::size_t k) {
+                auto& i = rows[k];
+                if (o.shuffle) {
+                    std::shuffle(i.begin(), i.end(), g[k]);
+                }
+                std::size_t e = 0;
+                if (o.deterministic) {
+                    T* w_ = d[k].data();
+                    std::copy(w.begin(), w.end(), w_);
+                    for (const std::size_t j : i) {
+                        const T* x = row(X, j);
+                        const bool y_ = linalg::dot(n, w_, x) > 0;
+                        if (y_ != y[j]) {
+                            linalg::axpy(n, o.alpha * (T(y[j]) - T(y_)), x, w_, w_);
+                            ++e;
+                        }
+                    }
+                }
+                else {
+                    for (const std::size_t j : i) {
+                        const T* x = row(X, j);
+                        T wx = 0;
+                        for (std::size_t l = 0; l < n; ++l) {
+                            wx += std::atomic_ref<T>(w[l]).load(std::memory_order_relaxed) * x[l];
+                        }
+                        const bool y_ = wx > 0;
+                        if (y_ != y[j]) {
+                            const T a = o.alpha * (T(y[j]) - T(y_));
+                            for (std::size_t l = 0; l < n; ++l) {
+                                std::atomic_ref<T>(w[l]).fetch_add(a * x[l], std::memory_order_relaxed);
+                            }
+                            ++e;
+                        }
+                    }
+                }
+                errors += e;
+            });
+            if (o.deterministic) {
+                // w += sum_k (d_k - w) / S in shard order
+                std::vector<T> w0(w.begin(), w.end());
+                for (std::size_t k = 0; k < S; ++k) {
+                    linalg::axpy(n, T(1) / T(S), d[k].data(), w.data(), w.data());
+                    linalg::axpy(n, -T(1) / T(S), w0.data(), w.data(), w.data());
+                }
+            }
+            r.errors = errors;
+            ++r.epochs;
+        }
+
+        return r;
+    }
+
+#ifdef _DEBUG
+    inline int fit_parallel_test()
+    {
+        {
+            // separable by x0 - x1 > 0
+            std::vector<double> X;
+            std::vector<char> y_;
+            std::mt19937_64 g(1);
+            std::uniform_real_distribution<double> u(-1, 1);
+            while (y_.size() < 1000) {
+                const double x0 = u(g), x1 = u(g);
+                if (std::fabs(x0 - x1) > 0.1) {
+                    X.insert(X.end(), { x0, x1 });
+                    y_.push_back(x0 > x1);
+                }
+            }
+            const std::size_t N = y_.size();
+            std::unique_ptr<bool[]> y(new bool[N]);
+            std::copy(y_.begin(), y_.end(), y.get());
+            const matrix<const double> X_(X.data(), N, 2);
+
+            for (bool deterministic : { false, true }) {
+                for (std::size_t shards : { 1, 4 }) {
+                    double w[2] = { 0, 0 };
+                    parallel_options<> o;
+                    o.epochs = 1000;
+                    o.shards = shards;
+                    o.shuffle = true;
+                    o.deterministic = deterministic;
+                    const auto r = fit_parallel(X_, std::span<const bool>(y.get(), N), std::span<double>(w), o);
+                    ensure(r.errors == 0);
+                    if (deterministic) {
+                        double w_[2] = { 0, 0 };
+                        const auto r_ = fit_parallel(X_, std::span<const bool>(y.get(), N), std::span<double>(w_), o);
+                        ensure(r_.epochs == r.epochs && w_[0] == w[0] && w_[1] == w[1]);
+                    }
+                }
+            }
+
+            // deterministic default shards do not depend on the core count
+            {
+                parallel_options<> o;
+                o.epochs = 100;
+                o.shuffle = true;
+                o.deterministic = true;
+                double w[2] = { 0, 0 }, w_[2] = { 0, 0 };
+                fit_parallel(X_, std::span<const bool>(y.get(), N), std::span<double>(w), o);
+                o.shards = parallel_options<>::deterministic_shards;
+                fit_parallel(X_, std::span<const bool>(y.get(), N), std::span<double>(w_), o);
+                ensure(w_[0] == w[0] && w_[1] == w[1]);
+            }
+        }
+
+        return 0;
+    }
+#endif // _DEBUG
+
     template<class T = double>
     class neuron {
         // private
@@ -75,6 +342,14 @@ namespace fms::perceptron {
         {
             return perceptron::train(w.size(), w.data(), x, y, alpha, n);
         }
+        result fit(matrix<const T> X, std::span<const bool> y, const options<T>& o = {})
+        {
+            return perceptron::fit(X, y, span(), o);
+        }
+        result fit_parallel(matrix<const T> X, std::span<const bool> y, const parallel_options<T>& o = {})
+        {
+            return perceptron::fit_parallel(X, y, span(), o);
+        }
     };
  
 } // namespace fms::perceptron
\ No newline at end of file
@@ -136,6 +136,145 @@ namespace fms::pwflat {
 	}
 #endif // _DEBUG
 
+	// Cumulative integrals I[i] = int_0^t[i] f(s) ds.
+	template<class T, class F>
+	constexpr F* integrals(size_t n, const T* t, const F* f, F* I)
+	{
+		F I_ = 0;
+		T t_ = 0;
+
+		for (size_t i = 0; i < n; ++i) {
+			I_ += f[i] * (t[i] - t_);
+			I[i] = I_;
+			t_ = t[i];
+		}
+
+		return I;
+	}
+
+	// Integral from 0 to u of f given cumulative integrals I from integrals().
+	// One binary search instead of a linear walk over the knots.
+	template<class T, class F>
+	constexpr F integral(T u, size_t n, const T* t, const F* f, const F* I, F _f = math::NaN<F>)
+	{
+		if (u < 0)  return fms::math::NaN<F>;
+		if (u == 0) return 0;
+		if (n == 0) return u * _f;
+
+		size_t i = std::lower_bound(t, t + n, u) - t; // t[i-1] < u <= t[i]
+		if (i == 0) {
+			return f[0] * u;
+		}
+		if (i == n) {
+			return I[n - 1] + _f * (u - t[n - 1]);
+		}
+
+		return I[i - 1] + f[i] * (u - t[i - 1]);
+	}
+#ifdef _DEBUG
+	inline int integrals_test()
+	{
+		{
+			static constexpr double t[] = { 1,2,3 };
+			static constexpr double f[] = { 4,5,6 };
+			static constexpr double I[] = { 4,9,15 };
+			static_assert(math::isnan(integral(-1., 3, t, f, I)));
+			static_assert(integral(0., 3, t, f, I) == 0);
+			static_assert(integral(0.5, 3, t, f, I) == 4 * 0.5);
+			static_assert(integral(1., 3, t, f, I) == 4);
+			static_assert(integral(1.5, 3, t, f, I) == 4 + 5 * 0.5);
+			static_assert(integral(2., 3, t, f, I) == 4 + 5);
+			static_assert(integral(2.5, 3, t, f, I) == 4 + 5 + 6 * 0.5);
+			static_assert(integral(3., 3, t, f, I) == 4 + 5 + 6);
+			static_assert(math::isnan(integral(3.1, 3, t, f, I)));
+			static_assert(integral(3.5, 3, t, f, I, 7.) == 4 + 5 + 6 + 7 * 0.5);
+		}
+		{
+			double t[] = { 0.25, 1, 2.5, 10 };
+			double f[] = { 0.01, 0.02, 0.03, 0.04 };
+			double I[4];
+			integrals(4, t, f, I);
+			for (double u : { 0.1, 0.25, 0.5, 1., 2., 2.5, 7., 10., 11. }) {
+				ensure(integral(u, 4, t, f, I, 0.05) == integral(u, 4, t, f, 0.05));
+			}
+		}
+
+		return 0;
+	}
+#endif // _DEBUG
+
+	// Forwards at increasing times u[j] using one merge over knots and times.
+	template<class T, class F>
+	constexpr F* forward(size_t m, const T* u, F* fu, size_t n, const T* t, const F* f, F _f = math::NaN<F>)
+	{
+		size_t i = 0;
+		for (size_t j = 0; j < m; ++j) {
+			while (i < n && t[i] < u[j]) {
+				++i;
+			}
+			fu[j] = u[j] < 0 ? math::NaN<F> : i == n ? _f : f[i];
+		}
+
+		return fu;
+	}
+
+	// Integrals at increasing times u[j] using one merge over knots and times.
+	// Total cost is O(n + m) instead of O(m log n).
+	template<class T, class F>
+	constexpr F* integral(size_t m, const T* u, F* Iu, size_t n, const T* t, const F* f, const F* I, F _f = math::NaN<F>)
+	{
+		size_t i = 0;
+		for (size_t j = 0; j < m; ++j) {
+			while (i < n && t[i] < u[j]) {
+				++i;
+			}
+			// t[i-1] < u[j] <= t[i]
+			if (u[j] < 0) {
+				Iu[j] = math::NaN<F>;
+			}
+			else if (u[j] == 0) {
+				Iu[j] = 0;
+			}
+			else if (n == 0) {
+				Iu[j] = u[j] * _f;
+			}
+			else if (i == 0) {
+				Iu[j] = f[0] * u[j];
+			}
+			else if (i == n) {
+				Iu[j] = I[n - 1] + _f * (u[j] - t[n - 1]);
+			}
+			else {
+				Iu[j] = I[i - 1] + f[i] * (u[j] - t[i - 1]);
+			}
+		}
+
+		return Iu;
+	}
+#ifdef _DEBUG
+	inline int merge_test()
+	{
+		{
+			double t[] = { 0.25, 1, 2.5, 10 };
+			double f[] = { 0.01, 0.02, 0.03, 0.04 };
+			double I[4];
+			integrals(4, t, f, I);
+			double u[] = { -1, 0, 0.1, 0.25, 0.5, 1., 2., 2.5, 7., 10., 11. };
+			constexpr size_t m = sizeof(u) / sizeof(*u);
+			double Iu[m], fu[m];
+			integral(m, u, Iu, 4, t, f, I, 0.05);
+			forward(m, u, fu, 4, t, f, 0.05);
+			ensure(math::isnan(Iu[0]) && math::isnan(fu[0]));
+			for (size_t j = 1; j < m; ++j) {
+				ensure(Iu[j] == integral(u[j], 4, t, f, I, 0.05));
+				ensure(fu[j] == forward(u[j], 4, t, f, 0.05));
+			}
+		}
+
+		return 0;
+	}
+#endif // _DEBUG
+
 	// discount D(u) = exponential(-int_0^u f(t) dt)
 	template<class T, class F>
 	constexpr F discount(T u, size_t n, const T* t, const F* f, F _f = math::NaN<F>)
@@ -1,10 +1,93 @@
-// fmx_root1d.h - 1-d root using secant method
+// fmx_root1d.h - 1-d root using secant, Newton, Halley, and Brent methods
 #pragma once
+#include <atomic>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
 #include <tuple>
+#include <utility>
+#include "fms_error.h"
 #include "fms_math.h"
 
 namespace fms::root1d {
 
+	// Why a solver stopped.
+	enum class status {
+		converged,
+		iterations, // hit maximum number of iterations
+		bracket, // initial points do not bracket a root
+		derivative, // derivative vanished
+	};
+
+	// Telemetry for one call to solve.
+	template<class X = double>
+	struct stats {
+		std::size_t evaluations = 0; // function evaluations
+		X width = math::NaN<X>; // final bracket width or last step size
+		status reason = status::converged;
+	};
+
+	// Aggregate stats per caller, e.g. "bootstrap", "yield", "oas", "put_implied".
+	// Recording is off until enabled so production paths pay one atomic load.
+	class telemetry {
+	public:
+		struct summary {
+			std::size_t calls = 0;
+			std::size_t evaluations = 0;
+			std::size_t failures = 0;
+			std::size_t reasons[4] = {}; // indexed by status
+			double max_width = 0;
+		};
+	private:
+		static inline std::atomic<bool> on = false;
+		static inline std::mutex m;
+		static inline std::map<std::string, summary, std::less<>> s;
+	public:
+		static void enable(bool b = true)
+		{
+			on = b;
+		}
+		static bool enabled()
+		{
+			return on;
+		}
+		template<class X>
+		static void record(std::string_view caller, const stats<X>& st)
+		{
+			if (!enabled()) {
+				return;
+			}
+
+			std::lock_guard<std::mutex> lock(m);
+			auto i = s.find(caller);
+			if (i == s.end()) {
+				i = s.emplace(std::string(caller), summary{}).first;
+			}
+			auto& sum = i->second;
+			++sum.calls;
+			sum.evaluations += st.evaluations;
+			sum.failures += st.reason != status::converged;
+			++sum.reasons[static_cast<int>(st.reason)];
+			if (st.width == st.width && double(math::abs(st.width)) > sum.max_width) {
+				sum.max_width = double(math::abs(st.width));
+			}
+		}
+		// Copy of the current summaries.
+		static std::map<std::string, summary, std::less<>> snapshot()
+		{
+			std::lock_guard<std::mutex> lock(m);
+
+			return s;
+		}
+		static void reset()
+		{
+			std::lock_guard<std::mutex> lock(m);
+			s.clear();
+		}
+	};
+
 	// Move x to bracketed root in [a, b] given last bracketed guess x0.
 	template<class X>
 	constexpr X bracket(X x, X x0, X a = -fms::math::infinity<X>, X b = fms::math::infinity<X>)
@@ -37,6 +120,7 @@ namespace fms::root1d {
 		X x0, x1;
 		X tolerance;
 		size_t iterations;
+		stats<X>* sink = nullptr; // optional telemetry
 
 		secant(X x0, X x1, X tol = math::sqrt_epsilon<X>, size_t iter = 100)
 			: x0(x0), x1(x1), tolerance(tol), iterations(iter)
@@ -73,6 +157,9 @@ namespace fms::root1d {
 					bounded = !math::samesign(y0, y1);
 				}
 			}
+			if (sink) {
+				*sink = { n + 1, x1 - x0, n == iterations ? status::iterations : status::converged };
+			}
 			if (n == iterations) {
 				x1 = std::numeric_limits<X>::quiet_NaN();
 			}
@@ -99,6 +186,7 @@ namespace fms::root1d {
 		X x0;
 		X tolerance;
 		size_t iterations = 100;
+		stats<X>* sink = nullptr; // optional telemetry
 
 		newton(X x0, X tol = math::sqrt_epsilon<X>, size_t iter = 100)
 			: x0(x0), tolerance(tol), iterations(iter)
@@ -116,11 +204,16 @@ namespace fms::root1d {
 		{
 			auto y0 = f(x0);
 			size_t n = 0;
+			X dx = math::NaN<X>;
 			while (++n < iterations && math::abs(y0) > tolerance) {
 				auto x = next(x0, y0, df(x0));
+				dx = x - x0;
 				x0 = bracket(x, x0, a, b);
 				y0 = f(x0);
 			}
+			if (sink) {
+				*sink = { n, dx, n == iterations ? status::iterations : status::converged };
+			}
 			if (n == iterations) {
 				x0 = std::numeric_limits<X>::quiet_NaN();
 			}
@@ -140,5 +233,207 @@ namespace fms::root1d {
 #endif // _DEBUG	
 	};
 
+	// Find root given initial guess, first, and second derivative using Halley's method.
+	// Return root approximation, tolerance, and number of iterations.
+	template<class X = double, class Y = double>
+	struct halley {
+		X x0;
+		X tolerance;
+		size_t iterations = 100;
+		stats<X>* sink = nullptr; // optional telemetry
+
+		halley(X x0, X tol = math::sqrt_epsilon<X>, size_t iter = 100)
+			: x0(x0), tolerance(tol), iterations(iter)
+		{
+		}
+
+		// x - 2 f f' / (2 f'^2 - f f'')
+		constexpr auto next(X x, Y y, decltype(y / x) df, decltype(y / (x * x)) ddf)
+		{
+			return x - 2 * y * df / (2 * df * df - y * ddf);
+		}
+
+		template<class F, class dF, class ddF>
+		constexpr std::tuple<X, X, size_t> solve(const F& f, const dF& df, const ddF& ddf,
+			X a = -math::infinity<X>, X b = math::infinity<X>)
+		{
+			auto y0 = f(x0);
+			size_t n = 0;
+			X dx = math::NaN<X>;
+			status reason = status::converged;
+			while (++n < iterations && math::abs(y0) > tolerance) {
+				auto df0 = df(x0);
+				if (df0 == 0) {
+					reason = status::derivative;
+					break;
+				}
+				auto x = next(x0, y0, df0, ddf(x0));
+				dx = x - x0;
+				x0 = bracket(x, x0, a, b);
+				y0 = f(x0);
+			}
+			if (n == iterations) {
+				reason = status::iterations;
+			}
+			if (sink) {
+				*sink = { n, dx, reason };
+			}
+			if (reason != status::converged) {
+				x0 = std::numeric_limits<X>::quiet_NaN();
+			}
+
+			return { x0, y0, n };
+		}
+	};
+#ifdef _DEBUG
+	inline int halley_test()
+	{
+		{
+			stats<> s;
+			halley<> h(1.);
+			h.sink = &s;
+			auto [x, y, n] = h.solve([](double x) { return x * x - 4; }, [](double x) { return 2 * x; }, [](double) { return 2.; });
+			ensure(math::abs(x - 2) <= math::sqrt_epsilon<>);
+			ensure(s.reason == status::converged && s.evaluations == n);
+		}
+
+		return 0;
+	}
+#endif // _DEBUG
+
+	// Find root in the bracket [a, b] using Brent's method.
+	// Combines bisection, secant, and inverse quadratic interpolation
+	// and always keeps the root bracketed.
+	// Return root approximation, tolerance, and number of iterations.
+	template<class X = double, class Y = X>
+	struct brent {
+		X a, b;
+		X tolerance;
+		size_t iterations;
+		stats<X>* sink = nullptr; // optional telemetry
+
+		brent(X a, X b, X tol = math::sqrt_epsilon<X>, size_t iter = 100)
+			: a(a), b(b), tolerance(tol), iterations(iter)
+		{
+		}
+
+		template<class F>
+		constexpr std::tuple<X, X, size_t> solve(const F& f)
+		{
+			Y fa = f(a);
+			Y fb = f(b);
+			size_t n = 0;
+
+			if (math::samesign(fa, fb)) {
+				if (sink) {
+					*sink = { 2, b - a, status::bracket };
+				}
+
+				return { math::NaN<X>, fb, n };
+			}
+
+			X c = a, d = b - a, e = d;
+			Y fc = fa;
+			while (++n < iterations) {
+				if (math::samesign(fb, fc)) {
+					c = a;
+					fc = fa;
+					d = e = b - a;
+				}
+				if (math::abs(fc) < math::abs(fb)) {
+					a = b; b = c; c = a;
+					fa = fb; fb = fc; fc = fa;
+				}
+				const X m = (c - b) / 2;
+				const X tol = 2 * math::epsilon<X> * math::abs(b) + tolerance / 2;
+				if (math::abs(fb) <= tolerance || math::abs(m) <= tol) {
+					break;
+				}
+				if (math::abs(e) >= tol && math::abs(fa) > math::abs(fb)) {
+					// inverse quadratic interpolation or secant
+					X p, q, r;
+					const X s = fb / fa;
+					if (a == c) {
+						p = 2 * m * s;
+						q = 1 - s;
+					}
+					else {
+						q = fa / fc;
+						r = fb / fc;
+						p = s * (2 * m * q * (q - r) - (b - a) * (r - 1));
+						q = (q - 1) * (r - 1) * (s - 1);
+					}
+					if (p > 0) {
+						q = -q;
+					}
+					else {
+						p = -p;
+					}
+					if (2 * p < (std::min)(3 * m * q - math::abs(tol * q), math::abs(e * q))) {
+						e = d;
+						d = p / q;
+					}
+					else {
+						d = e = m; // bisection
+					}
+				}
+				else {
+					d = e = m; // bisection
+				}
+				a = b;
+				fa = fb;
+				b += math::abs(d) > tol ? d : (m > 0 ? tol : -tol);
+				fb = f(b);
+			}
+			if (sink) {
+				*sink = { n + 1, c - b, n == iterations ? status::iterations : status::converged };
+			}
+			if (n == iterations) {
+				b = std::numeric_limits<X>::quiet_NaN();
+			}
+
+			return { b, fb, n };
+		}
+	};
+#ifdef _DEBUG
+	inline int brent_test()
+	{
+		{
+			stats<> s;
+			brent<> r(0., 5.);
+			r.sink = &s;
+			auto [x, y, n] = r.solve([](double x) { return x * x - 4; });
+			ensure(math::abs(x - 2) <= math::sqrt_epsilon<>);
+			ensure(s.reason == status::converged);
+			ensure(math::abs(s.width) <= 5);
+		}
+		{
+			stats<> s;
+			brent<> r(3., 5.);
+			r.sink = &s;
+			auto [x, y, n] = r.solve([](double x) { return x * x - 4; });
+			ensure(math::isnan(x));
+			ensure(s.reason == status::bracket);
+		}
+		{
+			telemetry::reset();
+			telemetry::enable();
+			stats<> s{ 3, 0.1, status::converged };
+			telemetry::record("test", s);
+			s.reason = status::iterations;
+			telemetry::record("test", s);
+			telemetry::enable(false);
+			telemetry::record("test", s);
+			auto t = telemetry::snapshot();
+			ensure(t["test"].calls == 2);
+			ensure(t["test"].evaluations == 6);
+			ensure(t["test"].failures == 1);
+			telemetry::reset();
+		}
+
+		return 0;
+	}
+#endif // _DEBUG
+
 } // namespace fms::secant
 
@@ -1,7 +1,11 @@
 // fms_valuation.h - present value, duration, convexity, yield, oas
 #pragma once
 #include <cmath>
+#include <algorithm>
+#include <span>
+#include <type_traits>
 #include "fms_curve.h"
+#include "fms_curve_expr.h"
 #include "fms_instrument.h"
 #include "fms_root1d.h"
 
@@ -19,58 +23,164 @@ namespace fms::value {
 		return X(n * std::expm1(r / n));
 	}
 
-	// Present value at t of a zero coupon bond with cash flow c at time u.
-	template<class U, class C, class T, class F>
-	constexpr C present(const instrument::base<U,C>& i, const curve::base<T, F>& f)
+	// Call op(u[j], c[j], D(u[j])) for each cash flow of i.
+	// Discounts come from the batch curve API in blocks so an instrument costs one curve call per block.
+	// Curve is a curve::base or a curve::expr expression.
+	template<class U, class C, class Curve, class Op>
+	constexpr void discounted(const instrument::base<U, C>& i, const Curve& f, Op&& op)
 	{
-		C pv = 0;
+		using T = typename Curve::time_type;
+		using F = typename Curve::rate_type;
+		constexpr std::size_t N = 128; // block size
+		F D[N];
 
 		const U* u = i.time();
 		const C* c = i.cash();
-		for (size_t j = 0; j < i.size(); ++j) {
-			pv += c[j] * f.discount(u[j]);
+		for (std::size_t j0 = 0; j0 < i.size(); j0 += N) {
+			const std::size_t n = (std::min)(N, i.size() - j0);
+			if constexpr (std::is_same_v<U, T>) {
+				f.discount(std::span<const T>(u + j0, n), std::span<F>(D, n));
+			}
+			else {
+				T u_[N];
+				std::copy_n(u + j0, n, u_);
+				f.discount(std::span<const T>(u_, n), std::span<F>(D, n));
+			}
+			for (std::size_t j = 0; j < n; ++j) {
+				op(u[j0 + j], c[j0 + j], D[j]);
+			}
 		}
+	}
+
+	// Present value at t of a zero coupon bond with cash flow c at time u.
+	template<class U, class C, class Curve>
+	constexpr C present(const instrument::base<U,C>& i, const Curve& f)
+	{
+		C pv = 0;
+
+		discounted(i, f, [&pv](U, C c, auto D) { pv += c * D; });
 
 		return pv;
 	}
 
 	// Derivative of present value with respect to a parallel shift.
-	template<class U, class C, class T, class F>
-	constexpr auto duration(const instrument::base<U, C>& i, const curve::base<T, F>& f)
+	template<class U, class C, class Curve>
+	constexpr auto duration(const instrument::base<U, C>& i, const Curve& f)
 	{
 		C dur = 0;
 
-		const U* u = i.time();
-		const C* c = i.cash();
-		for (size_t j = 0; j < i.size(); ++j) {
-			dur += -u[j] * c[j] * f.discount(u[j]);
-		}
+		discounted(i, f, [&dur](U u, C c, auto D) { dur += -u * c * D; });
 
 		return dur;
 	}
 
 	// Duration divided by present value.
-	template<class U, class C, class T, class F>
-	constexpr auto macaulay_duration(const instrument::base<U, C>& i, const curve::base<T, F>& f)
+	template<class U, class C, class Curve>
+	constexpr auto macaulay_duration(const instrument::base<U, C>& i, const Curve& f)
 	{
 		return duration(i, f) / present(i, f);
 	}
 
 	// Second derivative of present value with respect to a parallel shift.
-	template<class U, class C, class T, class F>
-	constexpr auto convexity(const instrument::base<U, C>& i, const curve::base<T, F>& f)
+	template<class U, class C, class Curve>
+	constexpr auto convexity(const instrument::base<U, C>& i, const Curve& f)
 	{
 		C cnv = 0;
 
-		const U* u = i.time();
-		const C* c = i.cash();
-		for (size_t j = 0; j < i.size(); ++j) {
-			cnv += u[j] * u[j] * c[j] * f.discount(u[j]);
-		}
+		discounted(i, f, [&cnv](U u, C c, auto D) { cnv += u * u * c * D; });
 
 		return cnv;
 	}
 
+	// Risk numbers computed together by analytics.
+	template<class C = double>
+	struct analytic {
+		C present;
+		C duration;
+		C macaulay_duration;
+		C convexity;
+	};
+
+	// Present value, duration, Macaulay duration, and convexity from one pass over the cash flows.
+	template<class U, class C, class Curve>
+	constexpr analytic<C> analytics(const instrument::base<U, C>& i, const Curve& f)
+	{
+		C pv = 0, dur = 0, cnv = 0;
+
+		discounted(i, f, [&pv, &dur, &cnv](U u, C c, auto D) {
+			const C cD = c * D;
+			pv += cD;
+			dur += -u * cD;
+			cnv += u * u * cD;
+		});
+
+		return { pv, dur, dur / pv, cnv };
+	}
+
+	// Analytics of many instruments sharing one curve.
+	template<class U, class C, class Curve>
+	constexpr void analytics(std::span<const instrument::base<U, C>* const> is, const Curve& f, std::span<analytic<C>> a)
+	{
+		ensure(is.size() == a.size() || !"value::analytics: instruments and results must have the same size");
+
+		for (std::size_t k = 0; k < is.size(); ++k) {
+			a[k] = analytics(*is[k], f);
+		}
+	}
+	// Present values of every instrument in a portfolio streaming through its cash flow arrays.
+	template<class U, class C, class Curve>
+	constexpr void present(const instrument::portfolio<U, C>& p, const Curve& f, std::span<C> pv)
+	{
+		ensure(p.size() == pv.size() || !"value::present: portfolio and results must have the same size");
+
+		for (std::size_t k = 0; k < p.size(); ++k) {
+			pv[k] = present(p[k], f);
+		}
+	}
+
+	// Analytics of every instrument in a portfolio.
+	template<class U, class C, class Curve>
+	constexpr void analytics(const instrument::portfolio<U, C>& p, const Curve& f, std::span<analytic<C>> a)
+	{
+		ensure(p.size() == a.size() || !"value::analytics: portfolio and results must have the same size");
+
+		for (std::size_t k = 0; k < p.size(); ++k) {
+			a[k] = analytics(p[k], f);
+		}
+	}
+
+#ifdef _DEBUG
+	inline int analytics_test()
+	{
+		{
+			const instrument::bond<> b(5, 0.04);
+			const curve::constant<> f(0.03);
+			const auto a = analytics(b, f);
+			auto close = [](double x, double y) { return math::abs(x - y) <= 1e-12 * (1 + math::abs(y)); };
+			ensure(close(a.present, present(b, f)));
+			ensure(close(a.duration, duration(b, f)));
+			ensure(close(a.macaulay_duration, macaulay_duration(b, f)));
+			ensure(close(a.convexity, convexity(b, f)));
+
+			const instrument::base<>* is[] = { &b, &b };
+			analytic<> as[2];
+			analytics(std::span<const instrument::base<>* const>(is), f, std::span<analytic<>>(as));
+			ensure(as[1].present == a.present && as[1].convexity == a.convexity);
+
+			instrument::portfolio<> p;
+			p.push_back(b).push_back(instrument::zero_coupon_bond<>(2.));
+			double pv[2];
+			present(p, f, std::span<double>(pv));
+			ensure(pv[0] == present(b, f));
+			ensure(pv[1] == f.discount(2.));
+			analytics(p, f, std::span<analytic<>>(as));
+			ensure(as[0].present == a.present && as[1].present == pv[1]);
+		}
+
+		return 0;
+	}
+#endif // _DEBUG
+
 	// Price of the instrument at constant yield y.
 	template<class U, class C>
 	inline C price(const instrument::base<U, C>& i, C y)
@@ -83,19 +193,31 @@ namespace fms::value {
 	inline auto yield(const instrument::base<U, C>& i, C p = 0,
 		C y0 = 0.01, C tol = math::sqrt_epsilon<C>, int iter = 100)
 	{
-		const auto pv = [&i, p](C y_) { return present(i, curve::constant<U, C>(y_)) - p; };
+		const auto pv = [&i, p](C y_) { return present(i, curve::expr::make(curve::constant<U, C>(y_))) - p; };
 
-		return root1d::secant(y0, y0 + 0.1, tol, iter).solve(pv);
+		root1d::stats<C> s;
+		root1d::secant r(y0, y0 + 0.1, tol, iter);
+		r.sink = &s;
+		const auto res = r.solve(pv);
+		root1d::telemetry::record("yield", s);
+
+		return res;
 	}
 
 	// Option adjusted spread for which the present value of the instrument equals price.
-	template<class U, class C, class T, class F>
-	inline auto oas(const instrument::base<U, C>& i, const curve::base<T, F>& f, F p,
+	template<class U, class C, class Curve, class F = typename Curve::rate_type>
+	inline auto oas(const instrument::base<U, C>& i, const Curve& f, F p,
 		F s0 = 0, F tol = math::sqrt_epsilon<F>, int iter = 100)
 	{
-		const auto pv = [p, &i, &f](F s_) { return present(i, f + curve::constant<T, F>(s_)) - p; };
+		const auto pv = [p, &i, &f](F s_) { return present(i, curve::expr::make(f) + s_) - p; };
+
+		root1d::stats<F> s;
+		root1d::secant r(s0, s0 + .01, tol, iter);
+		r.sink = &s;
+		const auto res = r.solve(pv);
+		root1d::telemetry::record("oas", s);
 
-		return root1d::secant(s0, s0 + .01, tol, iter).solve(pv);
+		return res;
 	}
 
 } // namespace fms::value
\ No newline at end of file
@@ -0,0 +1,204 @@
+// fms_valuation_batch.h - Yield and option adjusted spread for every instrument in a portfolio.
+/*
+	Both problems solve sum_j w_j exp(-x u_j) = p for each instrument where
+	w_j = c_j for yield and w_j = c_j D(u_j) for oas. The curve does not
+	depend on the spread so it is evaluated once per cash flow, not once
+	per solver iteration. Newton iterations run in lockstep over all
+	instruments and converged or failed instruments drop out of the active
+	set. Steps fall back to bisection once the root is bracketed.
+*/
+#pragma once
+#include <cmath>
+#include <algorithm>
+#include <span>
+#include <string_view>
+#include <vector>
+#include "fms_error.h"
+#include "fms_math.h"
+#include "fms_instrument.h"
+#include "fms_valuation.h"
+
+namespace fms::value {
+
+	// Root, residual, and number of evaluations for one instrument.
+	template<class X = double>
+	struct root {
+		X x;
+		X residual;
+		std::size_t iterations;
+	};
+
+	// Solve sum_j w_j exp(-x u_j) = p[k] for every instrument k of a portfolio.
+	// The weights w are parallel to the cash flows of the portfolio.
+	// Roots that do not converge in iter evaluations, or hit a non-finite residual or step, are NaN.
+	// Steps that overflow are halved. Once the root is bracketed Newton steps that leave the
+	// bracket or do not halve the previous step are replaced by bisection.
+	// Per instrument stats are recorded to root1d::telemetry under caller.
+	template<class U, class C>
+	inline void solve(const instrument::portfolio<U, C>& p, std::span<const C> w, std::span<const C> price,
+		std::span<root<C>> r, C x0, C tol = math::sqrt_epsilon<C>, std::size_t iter = 100,
+		std::string_view caller = "solve")
+	{
+		ensure(w.size() == p.cashes().size() || !"value::solve: weights must be parallel to cash flows");
+		ensure(price.size() == p.size() || !"value::solve: one price per instrument");
+		ensure(r.size() == p.size() || !"value::solve: one result per instrument");
+
+		const auto u = p.times();
+		const auto o = p.offsets();
+
+		// last points with negative and positive residual, NaN until seen
+		struct side {
+			C x = math::NaN<C>;
+			C y = math::NaN<C>;
+		};
+		std::vector<side> neg(p.size()), pos(p.size());
+		std::vector<C> last(p.size(), math::NaN<C>); // last point with finite residual
+		std::vector<root1d::stats<C>> st(p.size()); // width is the last step
+		std::vector<std::size_t> active(p.size());
+		for (std::size_t k = 0; k < p.size(); ++k) {
+			active[k] = k;
+			r[k] = { x0, math::NaN<C>, 0 };
+		}
+
+		for (std::size_t n = 1; n <= iter && !active.empty(); ++n) {
+			std::size_t m = 0; // number still active
+			for (const std::size_t k : active) {
+				const C x = r[k].x;
+				C pv = 0, dpv = 0;
+				for (std::size_t j = o[k]; j < o[k + 1]; ++j) {
+					const C wD = w[j] * std::exp(-x * u[j]);
+					pv += wD;
+					dpv -= u[j] * wD;
+				}
+				const C y = pv - price[k];
+				r[k].residual = y;
+				r[k].iterations = n;
+				st[k].evaluations = n;
+				if (!std::isfinite(y) || !std::isfinite(dpv)) {
+					if (last[k] != last[k]) {
+						r[k].x = math::NaN<C>;
+						st[k].reason = root1d::status::derivative;
+
+						continue;
+					}
+					// step overflowed, damp it
+					r[k].x = (x + last[k]) / 2;
+					st[k].width = r[k].x - last[k];
+					active[m++] = k;
+
+					continue;
+				}
+				if (math::abs(y) <= tol) {
+					st[k].reason = root1d::status::converged;
+
+					continue;
+				}
+				last[k] = x;
+				(y < 0 ? neg[k] : pos[k]) = { x, y };
+
+				C x_ = x - y / dpv;
+				if (neg[k].x == neg[k].x && pos[k].x == pos[k].x) {
+					// bisect if Newton leaves the bracket or does not halve the last step
+					const C a = (std::min)(neg[k].x, pos[k].x), b = (std::max)(neg[k].x, pos[k].x);
+					if (!(a < x_ && x_ < b) || 2 * math::abs(x_ - x) > math::abs(st[k].width)) {
+						x_ = (a + b) / 2;
+					}
+				}
+				if (!std::isfinite(x_)) {
+					r[k].x = math::NaN<C>;
+					st[k].reason = root1d::status::derivative;
+
+					continue;
+				}
+				st[k].width = x_ - x;
+				r[k].x = x_;
+				active[m++] = k;
+			}
+			active.resize(m);
+		}
+		for (const std::size_t k : active) {
+			r[k].x = math::NaN<C>;
+			st[k].reason = root1d::status::iterations;
+		}
+
+		if (root1d::telemetry::enabled()) {
+			for (const auto& s : st) {
+				root1d::telemetry::record(caller, s);
+			}
+		}
+	}
+
+	// Constant yield matching each price.
+	template<class U, class C>
+	inline void yield(const instrument::portfolio<U, C>& p, std::span<const C> price, std::span<root<C>> r,
+		C y0 = 0.01, C tol = math::sqrt_epsilon<C>, std::size_t iter = 100)
+	{
+		solve(p, p.cashes(), price, r, y0, tol, iter, "yield");
+	}
+
+	// Option adjusted spread to curve f matching each price.
+	template<class U, class C, class Curve>
+	inline void oas(const instrument::portfolio<U, C>& p, const Curve& f, std::span<const C> price, std::span<root<C>> r,
+		C s0 = 0, C tol = math::sqrt_epsilon<C>, std::size_t iter = 100)
+	{
+		std::vector<C> w(p.cashes().size());
+		const auto o = p.offsets();
+		for (std::size_t k = 0; k < p.size(); ++k) {
+			std::size_t j = o[k];
+			discounted(p[k], f, [&w, &j](U, C c, auto D) { w[j++] = c * D; });
+		}
+
+		solve(p, std::span<const C>(w), price, r, s0, tol, iter, "oas");
+	}
+
+#ifdef _DEBUG
+	inline int batch_test()
+	{
+		{
+			instrument::portfolio<> p;
+			for (int u = 1; u <= 10; ++u) {
+				p.push_back(instrument::bond<>(u, 0.01 * u));
+			}
+			std::vector<double> price(p.size(), 1.);
+			std::vector<root<>> r(p.size());
+
+			yield(p, std::span<const double>(price), std::span(r));
+			for (std::size_t k = 0; k < p.size(); ++k) {
+				const auto [y, res, n] = value::yield(p[k], price[k]);
+				ensure(math::abs(r[k].x - y) <= 1e-7);
+				ensure(math::abs(r[k].residual) <= math::sqrt_epsilon<>);
+				ensure(r[k].iterations < 10);
+			}
+
+			const curve::constant<> f(0.02);
+			oas(p, f, std::span<const double>(price), std::span(r));
+			for (std::size_t k = 0; k < p.size(); ++k) {
+				const auto [s, res, n] = value::oas(p[k], f, price[k]);
+				ensure(math::abs(r[k].x - s) <= 1e-7);
+			}
+
+			// far starting points converge, bad prices fail
+			yield(p, std::span<const double>(price), std::span(r), 3.);
+			for (std::size_t k = 0; k < p.size(); ++k) {
+				ensure(math::abs(r[k].x - std::get<0>(value::yield(p[k], price[k]))) <= 1e-7);
+			}
+			price[0] = math::NaN<>;
+			price[1] = -1;
+			root1d::telemetry::reset();
+			root1d::telemetry::enable();
+			yield(p, std::span<const double>(price), std::span(r));
+			root1d::telemetry::enable(false);
+			ensure(math::isnan(r[0].x) && r[0].iterations == 1);
+			ensure(math::isnan(r[1].x));
+			ensure(!math::isnan(r[2].x));
+			const auto t = root1d::telemetry::snapshot();
+			ensure(t.at("yield").calls == p.size());
+			ensure(t.at("yield").failures == 2);
+			root1d::telemetry::reset();
+		}
+
+		return 0;
+	}
+#endif // _DEBUG
+
+} // namespace fms::value
@@ -0,0 +1,94 @@
+// fms_valuation_engine.h - Present values of a portfolio under many curves in parallel.
+#pragma once
+#include <algorithm>
+#include <execution>
+#include <numeric>
+#include <span>
+#include <vector>
+#include "fms_error.h"
+#include "fms_instrument.h"
+#include "fms_curve.h"
+#include "fms_mdspan.h"
+#include "fms_valuation.h"
+
+namespace fms::value {
+
+	// Value every instrument of a portfolio under every curve, e.g. a base curve and scenarios.
+	// Work is split into tiles of one curve and a block of instruments so the curve
+	// stays in cache while the block streams through the portfolio arrays.
+	// Assumes lifetime of the portfolio and curves.
+	template<class U = double, class C = double, class T = double, class F = double>
+	class engine {
+		const instrument::portfolio<U, C>& p;
+		std::vector<const curve::base<T, F>*> f;
+		std::size_t block; // instruments per tile
+	public:
+		engine(const instrument::portfolio<U, C>& p, std::span<const curve::base<T, F>* const> f, std::size_t block = 256)
+			: p(p), f(f.begin(), f.end()), block(block ? block : 1)
+		{
+			ensure(std::none_of(this->f.begin(), this->f.end(), [](const auto* f_) { return f_ == nullptr; })
+				|| !"value::engine: curve pointer is null");
+		}
+		engine(const engine&) = default;
+		engine& operator=(const engine&) = delete;
+		~engine() = default;
+
+		// Number of curves.
+		std::size_t curves() const
+		{
+			return f.size();
+		}
+		// Number of instruments.
+		std::size_t instruments() const
+		{
+			return p.size();
+		}
+
+		// pv[n, k] is the present value of instrument k under curve n.
+		void present(matrix<C> pv) const
+		{
+			ensure((pv.extent(0) == curves() && pv.extent(1) == instruments())
+				|| !"value::engine: pv must be curves x instruments");
+
+			const std::size_t K = instruments();
+			const std::size_t B = (K + block - 1) / block; // blocks per curve
+			std::vector<std::size_t> tile(curves() * B);
+			std::iota(tile.begin(), tile.end(), std::size_t(0));
+
+			std::for_each(std::execution::par, tile.begin(), tile.end(), [&](std::size_t t) {
+				const std::size_t n = t / B;
+				const std::size_t k0 = (t % B) * block;
+				const std::size_t k1 = (std::min)(k0 + block, K);
+				C* pv_ = row(pv, n);
+				for (std::size_t k = k0; k < k1; ++k) {
+					pv_[k] = value::present(p[k], *f[n]);
+				}
+			});
+		}
+	};
+
+#ifdef _DEBUG
+	inline int engine_test()
+	{
+		{
+			instrument::portfolio<> p;
+			for (int u = 1; u <= 10; ++u) {
+				p.push_back(instrument::bond<>(u, 0.01 * u));
+			}
+			curve::constant<> f0(0.03), f1(0.04), f2(0.05);
+			const curve::base<>* fs[] = { &f0, &f1, &f2 };
+			engine e(p, std::span<const curve::base<>* const>(fs), 3);
+			std::vector<double> pv(3 * 10);
+			e.present(matrix<double>(pv.data(), 3, 10));
+			for (std::size_t n = 0; n < 3; ++n) {
+				for (std::size_t k = 0; k < 10; ++k) {
+					ensure(pv[n * 10 + k] == value::present(p[k], *fs[n]));
+				}
+			}
+		}
+
+		return 0;
+	}
+#endif // _DEBUG
+
+} // namespace fms::value
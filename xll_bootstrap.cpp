@@ -1,12 +1,16 @@
 ﻿// xll_bootstrap.cpp - bootstrap functions
 #include <vector>
 #include "fms_bootstrap.h"
+#include "fms_bootstrap_scenario.h"
 #include "xll_fi.h"
  
 using namespace fms;
 using namespace xll;
 
 Auto<OpenAfter> xoa_bootstrap_test([](){ curve::bootstrap_test(); return 1; });
+#ifdef _DEBUG
+Auto<OpenAfter> xoa_bootstrap_scenario_test([](){ curve::bootstrap_scenario_test(); return 1; });
+#endif // _DEBUG
 
 AddIn xai_curve_pwflat_bootstrap_(
 	Function(XLL_HANDLEX, L"xll_curve_pwflat_bootstrap_", L"\\" CATEGORY L".CURVE.PWFLAT.BOOTSTRAP.")
@@ -55,3 +59,129 @@ HANDLEX WINAPI xll_curve_pwflat_bootstrap_(_FP12* pi, _FP12* pp)
 
 	return h;
 }
+
+AddIn xai_curve_pwflat_bootstrapper_(
+	Function(XLL_HANDLEX, L"xll_curve_pwflat_bootstrapper_", L"\\" CATEGORY L".CURVE.PWFLAT.BOOTSTRAPPER")
+	.Arguments({
+		Arg(XLL_FP, L"i", L"is an array of instrument handles."),
+		Arg(XLL_FP, L"p", L"is an array of prices."),
+		})
+	.Uncalced()
+	.Category(CATEGORY)
+	.FunctionHelp(L"Return a handle to a pwflat bootstrapped curve that can be updated with new prices.")
+);
+HANDLEX WINAPI xll_curve_pwflat_bootstrapper_(_FP12* pi, _FP12* pp)
+{
+#pragma XLLEXPORT
+	HANDLEX h = INVALID_HANDLEX;
+
+	try {
+		ensure(size(*pi) == size(*pp) || !"bootstrapper: instrument and price arrays must have same size");
+
+		int n = size(*pi);
+
+		std::vector<instrument::instrument<>*> is(n);
+		for (int i = 0; i < n; ++i) {
+			handle<instrument::base<>> inst(pi->array[i]);
+			ensure(inst || !__FUNCTION__ ": invalid instrument handle");
+			is[i] = inst.as<instrument::instrument<>>();
+		}
+		handle<curve::base<>> h_(new curve::bootstrapper<>(std::span(is.data(), is.size()), span(*pp)));
+		ensure(h_);
+		h = h_.get();
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+	}
+
+	return h;
+}
+
+AddIn xai_curve_pwflat_bootstrapper_update(
+	Function(XLL_FP, L"xll_curve_pwflat_bootstrapper_update", CATEGORY L".CURVE.PWFLAT.BOOTSTRAPPER.UPDATE")
+	.Arguments({
+		Arg(XLL_HANDLEX, L"h", L"is a handle returned by \\" CATEGORY L".CURVE.PWFLAT.BOOTSTRAPPER."),
+		Arg(XLL_FP, L"p", L"is an array of prices."),
+		})
+	.Uncalced()
+	.Category(CATEGORY)
+	.FunctionHelp(L"Return {handle, knots...} where knots are the 0-based indices of forwards that changed.")
+);
+_FP12* WINAPI xll_curve_pwflat_bootstrapper_update(HANDLEX h, _FP12* pp)
+{
+#pragma XLLEXPORT
+	static FPX w;
+
+	try {
+		handle<curve::base<>> h_(h);
+		ensure(h_);
+		curve::bootstrapper<>* pb = h_.as<curve::bootstrapper<>>();
+		ensure(pb || !__FUNCTION__ ": handle is not a bootstrapper");
+
+		auto moved = pb->update(span(*pp));
+
+		w.resize(1, 1 + (int)moved.size());
+		w[0] = h;
+		for (std::size_t i = 0; i < moved.size(); ++i) {
+			w[1 + (int)i] = static_cast<double>(moved[i]);
+		}
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+		return nullptr;
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+		return nullptr;
+	}
+
+	return w.get();
+}
+
+AddIn xai_curve_pwflat_jacobian(
+	Function(XLL_FP, L"xll_curve_pwflat_jacobian", CATEGORY L".CURVE.PWFLAT.JACOBIAN")
+	.Arguments({
+		Arg(XLL_FP, L"i", L"is an array of instrument handles."),
+		Arg(XLL_HANDLEX, L"c", L"is a handle to the curve bootstrapped from the instruments."),
+		})
+	.Category(CATEGORY)
+	.FunctionHelp(L"Return the lower triangular matrix of forward sensitivities to instrument prices.")
+);
+_FP12* WINAPI xll_curve_pwflat_jacobian(_FP12* pi, HANDLEX c)
+{
+#pragma XLLEXPORT
+	static FPX J;
+
+	try {
+		int n = size(*pi);
+
+		std::vector<instrument::instrument<>*> is(n);
+		for (int i = 0; i < n; ++i) {
+			handle<instrument::base<>> inst(pi->array[i]);
+			ensure(inst || !__FUNCTION__ ": invalid instrument handle");
+			is[i] = inst.as<instrument::instrument<>>();
+		}
+		handle<curve::base<>> c_(c);
+		ensure(c_);
+		const curve::pwflat<>* f = c_.as<curve::pwflat<>>();
+		ensure(f || !__FUNCTION__ ": curve must be pwflat");
+
+		J.resize(n, n);
+		curve::jacobian(std::span(is.data(), is.size()), *f, fms::matrix<double>(J.array(), n, n));
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return nullptr;
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+
+		return nullptr;
+	}
+
+	return J.get();
+}
@@ -1,10 +1,21 @@
 // xll_curve.cpp - curve functions
 #include "fms_curve_pwflat.h"
+#include "fms_curve_expr.h"
 #include "xll_fi.h"
 
 using namespace xll;
 using namespace fms;
 
+#ifdef _DEBUG
+Auto<OpenAfter> xoa_curve_pwflat_test([]() {
+	fms::pwflat::integrals_test();
+	fms::pwflat::merge_test();
+	curve::pwflat_test();
+	curve::expr::expression_test();
+	return 1;
+});
+#endif // _DEBUG
+
 static AddIn xai_curve_pwflat_(
 	Function(XLL_HANDLEX, L"xll_curve_pwflat_", L"\\" CATEGORY L".CURVE.PWFLAT")
 	.Arguments({
@@ -5,6 +5,10 @@
 using namespace xll;
 using namespace fms;
 
+#ifdef _DEBUG
+Auto<OpenAfter> xoa_instrument_portfolio_test([]() { instrument::portfolio_test(); return 1; });
+#endif // _DEBUG
+
 AddIn xai_instrument_(
 	Function(XLL_HANDLEX, L"xll_instrument_", L"\\" CATEGORY L".INSTRUMENT")
 	.Arguments({
@@ -8,8 +8,36 @@
 using namespace xll;
 using namespace fms::math;
 
+AddIn xai_erf(
+	Function(XLL_DOUBLE, L"xll_erf", CATEGORY L".ERF")
+	.Arguments({
+		Arg(XLL_DOUBLE, L"x", L"is the value to compute the error function for."),
+	})
+	.Category(CATEGORY)
+	.FunctionHelp(L"Return the error function of x.")
+);
+double WINAPI xll_erf(double x)
+{
+#pragma XLLEXPORT
+	return fms::math::erf(x);
+}
+
+AddIn xai_erfc(
+	Function(XLL_DOUBLE, L"xll_erfc", CATEGORY L".ERFC")
+	.Arguments({
+		Arg(XLL_DOUBLE, L"x", L"is the value to compute the complementary error function for."),
+	})
+	.Category(CATEGORY)
+	.FunctionHelp(L"Return the complementary error function of x.")
+);
+double WINAPI xll_erfc(double x)
+{
+#pragma XLLEXPORT
+	return fms::math::erfc(x);
+}
+
 AddIn xai_erf_as(
-	Function(XLL_DOUBLE, L"xll_erf_as", CATEGORY L".ERF")
+	Function(XLL_DOUBLE, L"xll_erf_as", CATEGORY L".ERF_AS")
 	.Arguments({
 		Arg(XLL_DOUBLE, L"x", L"is the value to compute the error function for."),
 	})
@@ -1,4 +1,5 @@
 ﻿// xll_ml.cpp
+#include <memory>
 #include "fms_perceptron.h"
 #include "xll_ml.h"
 
@@ -68,6 +69,107 @@ _FP12* WINAPI xll_perceptron_train(_FP12* pw, _FP12* px, BOOL y, double alpha, U
 	return pw;
 }
 
+AddIn xai_perceptron_fit(
+	Function(XLL_FP, L"xll_perceptron_fit", L"PERCEPTRON.FIT")
+	.Arguments({
+		Arg(XLL_FP, L"w", L"is an array of initial weights."),
+		Arg(XLL_FP, L"X", L"is a matrix with one input vector per row."),
+		Arg(XLL_FP, L"y", L"is an array of 0/1 labels for each row."),
+		Arg(XLL_DOUBLE, L"alpha", L"is the learning rate. (default=1.0)", 1.0),
+		Arg(XLL_UINT, L"epochs", L"is the maximum number of passes over the data. (default=100)", 100),
+		Arg(XLL_BOOL, L"shuffle", L"is an optional boolean indicating rows are visited in random order each epoch. (default=FALSE)"),
+		Arg(XLL_UINT, L"weights", L"is 0 for the last, 1 for averaged, or 2 for pocket weights. (default=0)"),
+		})
+	.Category(CATEGORY)
+	.FunctionHelp(L"Train perceptron weights on a data set.")
+);
+_FP12* WINAPI xll_perceptron_fit(_FP12* pw, _FP12* pX, _FP12* py, double alpha, UINT epochs, BOOL shuffle, UINT weights)
+{
+#pragma XLLEXPORT
+	try {
+		const auto n = size(*pw);
+		ensure(n && pX->columns == n || !"weight and input vector size mismatch");
+		ensure(size(*py) == pX->rows || !"one label per row");
+		ensure(weights <= 2 || !"weights must be 0, 1, or 2");
+
+		const auto N = size(*py);
+		std::unique_ptr<bool[]> y(new bool[N]); // std::vector<bool> has no span
+		for (std::size_t i = 0; i < N; ++i) {
+			y[i] = py->array[i] != 0;
+		}
+
+		options<> o;
+		o.alpha = alpha ? alpha : 1;
+		o.epochs = epochs ? epochs : 100;
+		o.shuffle = shuffle;
+		o.weights = static_cast<fms::perceptron::weights>(weights);
+
+		fit(fms::matrix<const double>(pX->array, pX->rows, pX->columns), std::span<const bool>(y.get(), N),
+			std::span<double>(pw->array, n), o);
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCDNAME__ ": unknown exception");
+	}
+
+	return pw;
+}
+
+AddIn xai_perceptron_fit_parallel(
+	Function(XLL_FP, L"xll_perceptron_fit_parallel", L"PERCEPTRON.FIT_PARALLEL")
+	.Arguments({
+		Arg(XLL_FP, L"w", L"is an array of initial weights."),
+		Arg(XLL_FP, L"X", L"is a matrix with one input vector per row."),
+		Arg(XLL_FP, L"y", L"is an array of 0/1 labels for each row."),
+		Arg(XLL_DOUBLE, L"alpha", L"is the learning rate. (default=1.0)", 1.0),
+		Arg(XLL_UINT, L"epochs", L"is the maximum number of passes over the data. (default=100)", 100),
+		Arg(XLL_UINT, L"shards", L"is the number of blocks of rows trained concurrently. (default is one per core, or 8 if deterministic)"),
+		Arg(XLL_BOOL, L"deterministic", L"is an optional boolean indicating shard updates are merged in order after each epoch. (default=FALSE)"),
+		})
+	.Category(CATEGORY)
+	.FunctionHelp(L"Train perceptron weights on a data set using all cores.")
+);
+_FP12* WINAPI xll_perceptron_fit_parallel(_FP12* pw, _FP12* pX, _FP12* py, double alpha, UINT epochs, UINT shards, BOOL deterministic)
+{
+#pragma XLLEXPORT
+	try {
+		const auto n = size(*pw);
+		ensure(n && pX->columns == n || !"weight and input vector size mismatch");
+		ensure(size(*py) == pX->rows || !"one label per row");
+
+		const auto N = size(*py);
+		std::unique_ptr<bool[]> y(new bool[N]);
+		for (std::size_t i = 0; i < N; ++i) {
+			y[i] = py->array[i] != 0;
+		}
+
+		parallel_options<> o;
+		o.alpha = alpha ? alpha : 1;
+		o.epochs = epochs ? epochs : 100;
+		o.shards = shards;
+		o.deterministic = deterministic;
+
+		fit_parallel(fms::matrix<const double>(pX->array, pX->rows, pX->columns), std::span<const bool>(y.get(), N),
+			std::span<double>(pw->array, n), o);
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCDNAME__ ": unknown exception");
+	}
+
+	return pw;
+}
+
+#ifdef _DEBUG
+Auto<OpenAfter> xoa_linalg_test([]() { fms::linalg::linalg_test(); return 1; });
+Auto<OpenAfter> xoa_perceptron_fit_test([]() { fit_test(); return 1; });
+Auto<OpenAfter> xoa_perceptron_fit_parallel_test([]() { fit_parallel_test(); return 1; });
+#endif // _DEBUG
+
 AddIn xai_neuron_(
 	Function(XLL_HANDLEX, L"xll_neuron_", L"\\NEURON")
 	.Arguments({
@@ -0,0 +1,229 @@
+// xll_nn.cpp - Neural network add-ins.
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "fms_nn.h"
+#include "fms_nn_attention.h"
+#include "xll_ml.h"
+
+#undef CATEGORY
+#define CATEGORY L"NN"
+
+using namespace xll;
+using namespace fms::nn;
+
+#ifdef _DEBUG
+// Count heap allocations in debug builds of this add-in.
+static std::atomic<std::size_t> allocations = 0;
+void* operator new(std::size_t n)
+{
+	++allocations;
+	if (void* p = std::malloc(n ? n : 1)) {
+		return p;
+	}
+	throw std::bad_alloc{};
+}
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+void operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+Auto<OpenAfter> xoa_nn_network_test([]() { network_test(); return 1; });
+Auto<OpenAfter> xoa_nn_train_allocation_test([]() { train_allocation_test([]() { return allocations.load(); }); return 1; });
+Auto<OpenAfter> xoa_nn_attention_test([]() { attention_test(); return 1; });
+#endif // _DEBUG
+
+AddIn xai_nn_(
+	Function(XLL_HANDLEX, L"xll_nn_", L"\\" CATEGORY)
+	.Arguments({
+		Arg(XLL_FP, L"widths", L"is an array of layer widths starting with the number of inputs."),
+		Arg(XLL_FP, L"activations", L"is an array of activations for each layer: 0 identity, 1 relu, 2 sigmoid, 3 tanh, 4 softmax."),
+		Arg(XLL_DOUBLE, L"_seed", L"is an optional seed for the initial weights. Default is 0."),
+		})
+	.Uncalced()
+	.Category(CATEGORY)
+	.FunctionHelp(L"Return handle to a neural network with dense layers.")
+);
+HANDLEX WINAPI xll_nn_(_FP12* pw, _FP12* pf, double seed)
+{
+#pragma XLLEXPORT
+	HANDLEX h = INVALID_HANDLEX;
+
+	try {
+		std::vector<std::size_t> w(size(*pw));
+		for (std::size_t i = 0; i < w.size(); ++i) {
+			ensure(pw->array[i] >= 1 || !"widths must be positive");
+			w[i] = static_cast<std::size_t>(pw->array[i]);
+		}
+		std::vector<activation> f(size(*pf));
+		for (std::size_t i = 0; i < f.size(); ++i) {
+			ensure((pf->array[i] >= 0 && pf->array[i] <= 4) || !"activation must be 0, 1, 2, 3, or 4");
+			f[i] = static_cast<activation>(static_cast<int>(pf->array[i]));
+		}
+
+		handle<network<>> h_(new network<>(std::span<const std::size_t>(w), std::span<const activation>(f),
+			static_cast<std::uint64_t>(seed)));
+		ensure(h_);
+
+		h = h_.get();
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCDNAME__ ": unknown exception");
+	}
+
+	return h;
+}
+
+AddIn xai_nn_parameters(
+	Function(XLL_FP, L"xll_nn_parameters", CATEGORY L".PARAMETERS")
+	.Arguments({
+		Arg(XLL_HANDLEX, L"h", L"is a handle returned by \\NN."),
+		})
+	.Category(CATEGORY)
+	.FunctionHelp(L"Return array of weights and biases of each layer.")
+);
+_FP12* WINAPI xll_nn_parameters(HANDLEX h)
+{
+#pragma XLLEXPORT
+	static FPX p;
+
+	try {
+		handle<network<>> h_(h);
+		ensure(h_);
+
+		const auto s = h_->parameters();
+		FPX p_((int)s.size(), 1, s.data());
+		p.swap(p_);
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+		return nullptr;
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCDNAME__ ": unknown exception");
+		return nullptr;
+	}
+
+	return p.get();
+}
+
+AddIn xai_nn_forward(
+	Function(XLL_FP, L"xll_nn_forward", CATEGORY L".FORWARD")
+	.Arguments({
+		Arg(XLL_HANDLEX, L"h", L"is a handle returned by \\NN."),
+		Arg(XLL_FP, L"X", L"is a matrix with one input vector per row."),
+		})
+	.Category(CATEGORY)
+	.FunctionHelp(L"Return matrix of network outputs for each row of X.")
+);
+_FP12* WINAPI xll_nn_forward(HANDLEX h, _FP12* pX)
+{
+#pragma XLLEXPORT
+	static FPX y;
+
+	try {
+		handle<network<>> h_(h);
+		ensure(h_);
+
+		const auto Y = h_->forward(fms::matrix<const double>(pX->array, pX->rows, pX->columns));
+		y.resize((int)Y.extent(0), (int)Y.extent(1));
+		std::copy(Y.data_handle(), Y.data_handle() + Y.size(), y.array());
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+		return nullptr;
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCDNAME__ ": unknown exception");
+		return nullptr;
+	}
+
+	return y.get();
+}
+
+AddIn xai_nn_train(
+	Function(XLL_FP, L"xll_nn_train", CATEGORY L".TRAIN")
+	.Arguments({
+		Arg(XLL_HANDLEX, L"h", L"is a handle returned by \\NN."),
+		Arg(XLL_FP, L"X", L"is a matrix with one input vector per row."),
+		Arg(XLL_FP, L"Y", L"is a matrix with one target vector per row."),
+		Arg(XLL_UINT, L"_loss", L"is 0 for mean squared error or 1 for cross entropy. Default is 0."),
+		Arg(XLL_DOUBLE, L"_alpha", L"is the learning rate. Default is 0.1."),
+		Arg(XLL_UINT, L"_epochs", L"is the number of passes over the data. Default is 1."),
+		Arg(XLL_UINT, L"_batch", L"is the number of rows in each mini-batch. Default is 32."),
+		})
+	.Uncalced()
+	.Category(CATEGORY)
+	.FunctionHelp(L"Return {handle, loss} after mini-batch gradient descent.")
+);
+_FP12* WINAPI xll_nn_train(HANDLEX h, _FP12* pX, _FP12* pY, UINT L, double alpha, UINT epochs, UINT batch)
+{
+#pragma XLLEXPORT
+	static FPX r(1, 2);
+
+	try {
+		handle<network<>> h_(h);
+		ensure(h_);
+		ensure(L <= 1 || !"loss must be 0 or 1");
+
+		const double l = h_->train(fms::matrix<const double>(pX->array, pX->rows, pX->columns),
+			fms::matrix<const double>(pY->array, pY->rows, pY->columns),
+			static_cast<loss>(L), alpha ? alpha : 0.1, epochs ? epochs : 1, batch ? batch : 32);
+
+		r[0] = h;
+		r[1] = l;
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+		return nullptr;
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCDNAME__ ": unknown exception");
+		return nullptr;
+	}
+
+	return r.get();
+}
+
+AddIn xai_nn_attention(
+	Function(XLL_FP, L"xll_nn_attention", CATEGORY L".ATTENTION")
+	.Arguments({
+		Arg(XLL_FP, L"Q", L"is a matrix of queries with one row per position."),
+		Arg(XLL_FP, L"K", L"is a matrix of keys with the same number of columns as Q."),
+		Arg(XLL_FP, L"V", L"is a matrix of values with the same number of rows as K."),
+		Arg(XLL_UINT, L"_heads", L"is the number of heads splitting the columns. Default is 1."),
+		Arg(XLL_BOOL, L"_causal", L"is an optional boolean indicating queries only see earlier keys. Default is FALSE."),
+		})
+	.Category(CATEGORY)
+	.FunctionHelp(L"Return scaled dot-product attention softmax(Q K'/sqrt(d)) V for each head.")
+);
+_FP12* WINAPI xll_nn_attention(_FP12* pQ, _FP12* pK, _FP12* pV, UINT h, BOOL causal)
+{
+#pragma XLLEXPORT
+	static FPX o;
+
+	try {
+		o.resize(pQ->rows, pV->columns);
+		attention(fms::matrix<const double>(pQ->array, pQ->rows, pQ->columns),
+			fms::matrix<const double>(pK->array, pK->rows, pK->columns),
+			fms::matrix<const double>(pV->array, pV->rows, pV->columns),
+			fms::matrix<double>(o.array(), pQ->rows, pV->columns), h ? h : 1, causal != FALSE);
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+		return nullptr;
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCDNAME__ ": unknown exception");
+		return nullptr;
+	}
+
+	return o.get();
+}
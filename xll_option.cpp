@@ -1,7 +1,9 @@
 // xll_option.cpp - Generalized option model
 #include "fms_option.h"
 #include "fms_option_normal.h"
+#include "fms_option_implied.h"
 #include "fms_option_discrete.h"
+#include "fms_option_cached.h"
 #include "xll_ml.h"
 
 #undef CATEGORY
@@ -23,6 +25,43 @@ base<>* model(HANDLEX m)
 	return m_.ptr();
 }
 
+AddIn xai_option_cached(
+	Function(XLL_HANDLEX, L"xll_option_cached", L"\\" CATEGORY L".CACHED")
+	.Arguments({
+		Arg(XLL_HANDLEX, L"m", L"is the handle to a model. It must outlive the cached model."),
+		Arg(XLL_DOUBLE, L"_tol", L"is an optional interpolation tolerance. Default is 1e-10."),
+		Arg(XLL_DOUBLE, L"_noise", L"is an optional largest model resolution, e.g. Monte Carlo standard error or largest atom, used as tolerance. Default is 1e-3."),
+		})
+	.Uncalced()
+	.Category(CATEGORY)
+	.FunctionHelp(L"Return handle to a model interpolating cdf tables of m. Use it anywhere a model handle is expected.")
+);
+HANDLEX WINAPI xll_option_cached(HANDLEX m, double tol, double noise)
+{
+#pragma XLLEXPORT
+	HANDLEX result = INVALID_HANDLEX;
+
+	try {
+		if (tol <= 0) {
+			tol = 1e-10;
+		}
+		if (noise <= 0) {
+			noise = 1e-3;
+		}
+		handle<base<>> m_(new cached<>(*model(m), tol, 8, 1 << 12, 8, noise));
+		ensure(m_);
+		result = m_.get();
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+	}
+
+	return result;
+}
+
 AddIn xai_option_cdf(
 	Function(XLL_DOUBLE, L"xll_option_cdf", CATEGORY L".CDF")
 	.Arguments({
@@ -101,61 +140,73 @@ double WINAPI xll_black_moneyness(double f, double s, double k, HANDLEX m)
 }
 
 AddIn xai_option_black_put(
-	Function(XLL_DOUBLE, L"xll_option_black_put", CATEGORY L".BLACK.PUT")
+	Function(XLL_FP, L"xll_option_black_put", CATEGORY L".BLACK.PUT")
 	.Arguments({
 		Arg(XLL_DOUBLE, L"f", L"is the forward price."),
 		Arg(XLL_DOUBLE, L"s", L"is the volatility."),
-		Arg(XLL_DOUBLE, L"k", L"is the strike price."),
+		Arg(XLL_FP, L"k", L"is an array of strike prices."),
 		Arg(XLL_HANDLEX, L"m", L"is the handle to a model."),
 		})
 		.Category(CATEGORY)
-	.FunctionHelp(L"Return price of a European put option under the model.")
+	.FunctionHelp(L"Return prices of European put options under the model for each strike.")
 );
-double WINAPI xll_option_black_put(double f, double s, double k, HANDLEX m)
+_FP12* WINAPI xll_option_black_put(double f, double s, _FP12* pk, HANDLEX m)
 {
 #pragma	XLLEXPORT
-	double result = NaN<double>;
+	static FPX result;
 
 	try {
-		result = black::put(f, s, k, *model(m));
+		const int n = size(*pk);
+		result.resize(pk->rows, pk->columns);
+		black::put_strip(f, s, std::span<const double>(pk->array, n), *model(m), std::span<double>(result.array(), n));
 	}
 	catch (const std::exception& ex) {
 		XLL_ERROR(ex.what());
+
+		return nullptr;
 	}
 	catch (...) {
 		XLL_ERROR(__FUNCTION__ ": unknown exception");
+
+		return nullptr;
 	}
 
-	return result;
+	return result.get();
 }
 
 AddIn xai_option_black_put_delta(
-	Function(XLL_DOUBLE, L"xll_option_black_put_delta", CATEGORY L".BLACK.PUT_DELTA")
+	Function(XLL_FP, L"xll_option_black_put_delta", CATEGORY L".BLACK.PUT_DELTA")
 	.Arguments({
 		Arg(XLL_DOUBLE, L"f", L"is the forward price."),
 		Arg(XLL_DOUBLE, L"s", L"is the volatility."),
-		Arg(XLL_DOUBLE, L"k", L"is the strike price."),
+		Arg(XLL_FP, L"k", L"is an array of strike prices."),
 		Arg(XLL_HANDLEX, L"m", L"is the handle to a model."),
 		})
 		.Category(CATEGORY)
-	.FunctionHelp(L"Return price of a European put option under the model.")
+	.FunctionHelp(L"Return deltas of European put options under the model for each strike.")
 );
-double WINAPI xll_option_black_put_delta(double f, double s, double k, HANDLEX m)
+_FP12* WINAPI xll_option_black_put_delta(double f, double s, _FP12* pk, HANDLEX m)
 {
 #pragma	XLLEXPORT
-	double result = NaN<double>;
+	static FPX result;
 
 	try {
-		result = black::put_delta(f, s, k, *model(m));
+		const int n = size(*pk);
+		result.resize(pk->rows, pk->columns);
+		black::delta_strip(f, s, std::span<const double>(pk->array, n), *model(m), std::span<double>(result.array(), n));
 	}
 	catch (const std::exception& ex) {
 		XLL_ERROR(ex.what());
+
+		return nullptr;
 	}
 	catch (...) {
 		XLL_ERROR(__FUNCTION__ ": unknown exception");
+
+		return nullptr;
 	}
 
-	return result;
+	return result.get();
 }
 
 AddIn xai_option_black_put_implied(
@@ -187,33 +238,141 @@ double WINAPI xll_option_black_put_implied(double f, double s, double k, HANDLEX
 	return result;
 }
 
+#ifdef _DEBUG
+Auto<OpenAfter> xoa_option_black_put_implied_test([]() { black::put_implied_test(); return 1; });
+Auto<OpenAfter> xoa_option_strip_test([]() { strip_test(); return 1; });
+Auto<OpenAfter> xoa_lru_test([]() { fms::lru_test(); return 1; });
+Auto<OpenAfter> xoa_option_cached_test([]() { cached_test(); return 1; });
+#endif // _DEBUG
+
+AddIn xai_option_black_put_implied_chain(
+	Function(XLL_FP, L"xll_option_black_put_implied_chain", CATEGORY L".BLACK.PUT_IMPLIED.CHAIN")
+	.Arguments({
+		Arg(XLL_FP, L"t", L"is an array of expiries for each quote."),
+		Arg(XLL_FP, L"f", L"is an array of forward prices for each quote."),
+		Arg(XLL_FP, L"k", L"is an array of strike prices."),
+		Arg(XLL_FP, L"p", L"is an array of put prices."),
+		Arg(XLL_HANDLEX, L"m", L"is the handle to a model."),
+		})
+	.Category(CATEGORY)
+	.FunctionHelp(L"Return annualized vols repricing a chain of puts. Quotes with the same expiry must be adjacent.")
+);
+_FP12* WINAPI xll_option_black_put_implied_chain(_FP12* pt, _FP12* pf, _FP12* pk, _FP12* pp, HANDLEX m)
+{
+#pragma XLLEXPORT
+	static FPX sigma;
+
+	try {
+		const int n = size(*pk);
+		ensure((size(*pt) == n && size(*pf) == n && size(*pp) == n) || !__FUNCTION__ ": t, f, k, and p must have the same size");
+
+		// group adjacent quotes by expiry and forward
+		std::vector<double> t, f;
+		std::vector<std::size_t> offset;
+		for (int j = 0; j < n; ++j) {
+			if (j == 0 || pt->array[j] != t.back() || pf->array[j] != f.back()) {
+				t.push_back(pt->array[j]);
+				f.push_back(pf->array[j]);
+				offset.push_back(j);
+			}
+		}
+		offset.push_back(n);
+
+		sigma.resize(pk->rows, pk->columns);
+		black::put_implied(std::span<const double>(t), std::span<const double>(f), std::span<const std::size_t>(offset),
+			std::span<const double>(pk->array, n), std::span<const double>(pp->array, n), *model(m), std::span<double>(sigma.array(), n));
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return nullptr;
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+
+		return nullptr;
+	}
+
+	return sigma.get();
+}
+
+AddIn xai_option_black_put_greeks(
+	Function(XLL_FP, L"xll_option_black_put_greeks", CATEGORY L".BLACK.PUT.GREEKS")
+	.Arguments({
+		Arg(XLL_DOUBLE, L"f", L"is the forward price."),
+		Arg(XLL_DOUBLE, L"s", L"is the volatility."),
+		Arg(XLL_FP, L"k", L"is an array of strike prices."),
+		Arg(XLL_HANDLEX, L"m", L"is the handle to a model."),
+		})
+		.Category(CATEGORY)
+	.FunctionHelp(L"Return rows {value, delta, gamma, vega, vanna} of European put options for each strike.")
+);
+_FP12* WINAPI xll_option_black_put_greeks(double f, double s, _FP12* pk, HANDLEX m)
+{
+#pragma	XLLEXPORT
+	static FPX result;
+
+	try {
+		const int n = size(*pk);
+		std::vector<black::greeks<>> g(n);
+		black::greeks_strip(f, s, std::span<const double>(pk->array, n), *model(m), std::span<black::greeks<>>(g));
+		result.resize(n, 5);
+		for (int j = 0; j < n; ++j) {
+			double* row = result.array() + 5 * j;
+			row[0] = g[j].value;
+			row[1] = g[j].delta;
+			row[2] = g[j].gamma;
+			row[3] = g[j].vega;
+			row[4] = g[j].vanna;
+		}
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return nullptr;
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+
+		return nullptr;
+	}
+
+	return result.get();
+}
+
 AddIn xai_option_black_call(
-	Function(XLL_DOUBLE, L"xll_option_black_call", CATEGORY L".BLACK.CALL")
+	Function(XLL_FP, L"xll_option_black_call", CATEGORY L".BLACK.CALL")
 	.Arguments({
 		Arg(XLL_DOUBLE, L"f", L"is the forward price."),
 		Arg(XLL_DOUBLE, L"s", L"is the volatility."),
-		Arg(XLL_DOUBLE, L"k", L"is the strike price."),
+		Arg(XLL_FP, L"k", L"is an array of strike prices."),
 		Arg(XLL_HANDLEX, L"m", L"is the handle to a model."),
 		})
 		.Category(CATEGORY)
-	.FunctionHelp(L"Return price of a European call option under the model.")
+	.FunctionHelp(L"Return prices of European call options under the model for each strike.")
 );
-double WINAPI xll_option_black_call(double f, double s, double k, HANDLEX m)
+_FP12* WINAPI xll_option_black_call(double f, double s, _FP12* pk, HANDLEX m)
 {
 #pragma	XLLEXPORT
-	double result = NaN<double>;
+	static FPX result;
 
 	try {
-		result = black::call(f, s, k, *model(m));
+		const int n = size(*pk);
+		result.resize(pk->rows, pk->columns);
+		black::call_strip(f, s, std::span<const double>(pk->array, n), *model(m), std::span<double>(result.array(), n));
 	}
 	catch (const std::exception& ex) {
 		XLL_ERROR(ex.what());
+
+		return nullptr;
 	}
 	catch (...) {
 		XLL_ERROR(__FUNCTION__ ": unknown exception");
+
+		return nullptr;
 	}
 
-	return result;
+	return result.get();
 }
 
 AddIn xai_option_bsm_put(
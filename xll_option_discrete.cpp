@@ -8,6 +8,10 @@
 using namespace xll;
 using namespace fms::option;
 
+#ifdef _DEBUG
+Auto<OpenAfter> xoa_option_discrete_model_test([]() { discrete::model_test(); return 1; });
+#endif // _DEBUG
+
 AddIn xai_option_discrete_(
 	Function(XLL_HANDLEX, L"xll_option_discrete_", L"\\" CATEGORY L".DISCRETE")
 	.Arguments({
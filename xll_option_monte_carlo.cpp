@@ -0,0 +1,83 @@
+// xll_option_monte_carlo.cpp
+#include "fms_option_monte_carlo.h"
+#include "xll_ml.h"
+
+#undef CATEGORY
+#define CATEGORY L"OPTION"
+
+using namespace xll;
+using namespace fms::option;
+
+#ifdef _DEBUG
+Auto<OpenAfter> xoa_option_monte_carlo_test([]() { monte_carlo_test(); return 1; });
+#endif // _DEBUG
+
+AddIn xai_option_monte_carlo_(
+	Function(XLL_HANDLEX, L"xll_option_monte_carlo_", L"\\" CATEGORY L".MONTE_CARLO")
+	.Arguments({
+		Arg(XLL_DOUBLE, L"n", L"is the number of antithetic draws."),
+		Arg(XLL_DOUBLE, L"_seed", L"is an optional seed for the random streams. Default is 0."),
+		})
+	.Uncalced()
+	.Category(CATEGORY)
+	.FunctionHelp(L"Return handle to a Monte Carlo option pricing model of a standard normal.")
+);
+HANDLEX WINAPI xll_option_monte_carlo_(double n, double seed)
+{
+#pragma XLLEXPORT
+	HANDLEX result = INVALID_HANDLEX;
+
+	try {
+		ensure(n > 1 || !__FUNCTION__ ": number of draws must be greater than 1");
+		handle<base<>> m_(new monte_carlo<>(monte_carlo<>::standard_normal,
+			static_cast<std::size_t>(n), static_cast<std::uint64_t>(seed)));
+		ensure(m_);
+		result = m_.get();
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+	}
+
+	return result;
+}
+
+AddIn xai_option_monte_carlo_cdf(
+	Function(XLL_FP, L"xll_option_monte_carlo_cdf", CATEGORY L".MONTE_CARLO.CDF")
+	.Arguments({
+		Arg(XLL_DOUBLE, L"x", L"is the value at which to evaluate the share distribution."),
+		Arg(XLL_DOUBLE, L"s", L"is the volatility."),
+		Arg(XLL_HANDLEX, L"m", L"is a handle to a Monte Carlo model."),
+		})
+	.Category(CATEGORY)
+	.FunctionHelp(L"Return {cdf, standard error} of the Monte Carlo share distribution.")
+);
+_FP12* WINAPI xll_option_monte_carlo_cdf(double x, double s, HANDLEX m)
+{
+#pragma XLLEXPORT
+	static FPX result(1, 2);
+
+	try {
+		handle<base<>> m_(m);
+		ensure(m_);
+		const monte_carlo<>* pm = m_.as<monte_carlo<>>();
+		ensure(pm || !__FUNCTION__ ": model must be Monte Carlo");
+		const auto e = pm->cdf_estimate(x, s);
+		result[0] = e.value;
+		result[1] = e.error;
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return nullptr;
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+
+		return nullptr;
+	}
+
+	return result.get();
+}
@@ -1,5 +1,7 @@
 // xll_valuation.cpp - valuation routines
 #include "fms_valuation.h"
+#include "fms_valuation_engine.h"
+#include "fms_valuation_batch.h"
 #define CATEGORY L"FI"
 #include "xll_ml.h"
 
@@ -37,3 +39,155 @@ double WINAPI xll_valuation_present(HANDLEX i, HANDLEX c)
 
 	return pv;
 }
+
+#ifdef _DEBUG
+Auto<OpenAfter> xoa_value_analytics_test([]() { value::analytics_test(); return 1; });
+Auto<OpenAfter> xoa_value_engine_test([]() { value::engine_test(); return 1; });
+Auto<OpenAfter> xoa_value_batch_test([]() { value::batch_test(); return 1; });
+Auto<OpenAfter> xoa_root1d_halley_test([]() { root1d::halley_test(); return 1; });
+Auto<OpenAfter> xoa_root1d_brent_test([]() { root1d::brent_test(); return 1; });
+#endif // _DEBUG
+
+AddIn xai_root1d_telemetry_enable(
+	Function(XLL_BOOL, L"xll_root1d_telemetry_enable", CATEGORY L".ROOT1D.TELEMETRY.ENABLE")
+	.Arguments({
+		Arg(XLL_BOOL, L"enable", L"is a boolean indicating solver stats are recorded."),
+		Arg(XLL_BOOL, L"_reset", L"is an optional boolean to clear recorded stats. Default is false."),
+		})
+	.Category(CATEGORY)
+	.FunctionHelp(L"Turn recording of solver stats on or off and return whether it is on.")
+);
+BOOL WINAPI xll_root1d_telemetry_enable(BOOL enable, BOOL reset)
+{
+#pragma XLLEXPORT
+	if (reset) {
+		root1d::telemetry::reset();
+	}
+	root1d::telemetry::enable(enable != FALSE);
+
+	return root1d::telemetry::enabled();
+}
+
+AddIn xai_root1d_telemetry(
+	Function(XLL_FP, L"xll_root1d_telemetry", CATEGORY L".ROOT1D.TELEMETRY")
+	.Volatile()
+	.Category(CATEGORY)
+	.FunctionHelp(L"Return rows {calls, evaluations, failures, max width} for bootstrap, yield, oas, and put_implied "
+		L"recorded while " CATEGORY L".ROOT1D.TELEMETRY.ENABLE is on.")
+);
+_FP12* WINAPI xll_root1d_telemetry()
+{
+#pragma XLLEXPORT
+	static FPX t(4, 4);
+
+	try {
+		const auto s = root1d::telemetry::snapshot();
+		const char* caller[] = { "bootstrap", "yield", "oas", "put_implied" };
+		for (int i = 0; i < 4; ++i) {
+			const auto j = s.find(caller[i]);
+			const auto sum = j == s.end() ? root1d::telemetry::summary{} : j->second;
+			double* row = t.array() + 4 * i;
+			row[0] = static_cast<double>(sum.calls);
+			row[1] = static_cast<double>(sum.evaluations);
+			row[2] = static_cast<double>(sum.failures);
+			row[3] = sum.max_width;
+		}
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return nullptr;
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+
+		return nullptr;
+	}
+
+	return t.get();
+}
+
+AddIn xai_value_analytics(
+	Function(XLL_FP, L"xll_valuation_analytics", CATEGORY L".VALUATION.ANALYTICS")
+	.Arguments({
+		Arg(XLL_HANDLEX, L"i", L"is a handle to an instrument."),
+		Arg(XLL_HANDLEX, L"c", L"is a handle to a curve."),
+		})
+	.Category(CATEGORY)
+	.FunctionHelp(L"Return {present value, duration, Macaulay duration, convexity} of instrument given a curve.")
+);
+_FP12* WINAPI xll_valuation_analytics(HANDLEX i, HANDLEX c)
+{
+#pragma XLLEXPORT
+	static FPX a(1, 4);
+
+	try {
+		handle<instrument::base<>> i_(i);
+		ensure(i_);
+		handle<curve::base<>> c_(c);
+		ensure(c_);
+
+		const auto a_ = value::analytics(*i_, *c_);
+		a[0] = a_.present;
+		a[1] = a_.duration;
+		a[2] = a_.macaulay_duration;
+		a[3] = a_.convexity;
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+		return nullptr;
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+		return nullptr;
+	}
+
+	return a.get();
+}
+
+AddIn xai_value_present_matrix(
+	Function(XLL_FP, L"xll_valuation_present_matrix", CATEGORY L".VALUATION.PRESENT.MATRIX")
+	.Arguments({
+		Arg(XLL_FP, L"i", L"is an array of instrument handles."),
+		Arg(XLL_FP, L"c", L"is an array of curve handles."),
+		})
+	.Category(CATEGORY)
+	.FunctionHelp(L"Return the present value of each instrument (columns) under each curve (rows).")
+);
+_FP12* WINAPI xll_valuation_present_matrix(_FP12* pi, _FP12* pc)
+{
+#pragma XLLEXPORT
+	static FPX pv;
+
+	try {
+		int k = size(*pi);
+		int n = size(*pc);
+
+		instrument::portfolio<> p;
+		for (int i = 0; i < k; ++i) {
+			handle<instrument::base<>> i_(pi->array[i]);
+			ensure(i_ || !__FUNCTION__ ": invalid instrument handle");
+			p.push_back(*i_);
+		}
+		std::vector<const curve::base<>*> f(n);
+		for (int j = 0; j < n; ++j) {
+			handle<curve::base<>> c_(pc->array[j]);
+			ensure(c_ || !__FUNCTION__ ": invalid curve handle");
+			f[j] = c_.ptr();
+		}
+
+		pv.resize(n, k);
+		value::engine e(p, std::span<const curve::base<>* const>(f));
+		e.present(fms::matrix<double>(pv.array(), n, k));
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+		return nullptr;
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+		return nullptr;
+	}
+
+	return pv.get();
+}